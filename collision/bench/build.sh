@@ -0,0 +1,4 @@
+time c++ main.cpp -O2 -march=native -std=c++11 -pthread -o bench
+time c++ main.cpp -O2 -march=native -std=c++11 -pthread -DTJH_MATH_NO_SIMD -o bench_scalar
+time c++ main.cpp -O2 -march=native -std=c++11 -pthread -DTJH_MATH_FAST -o bench_fast
+time c++ main.cpp -O1 -g -march=native -std=c++11 -pthread -fsanitize=address -o bench_asan && ./bench_asan pool
@@ -0,0 +1,915 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <functional>
+
+#include "../tjh_math.h"
+#include "../tjh_collision.h"
+#include "../tjh_broadphase.h"
+#include "../tjh_aabb_tree.h"
+#include "../tjh_parallel.h"
+#include "../tjh_collision3d.h"
+#include "../tjh_fixed.h"
+#include "../tjh_raycast.h"
+
+//
+// Benchmarks for the collision code that doesn't need a window.
+// build.sh builds this three times, `bench` with SIMD, `bench_scalar` with
+// TJH_MATH_NO_SIMD and `bench_fast` with TJH_MATH_FAST, run them to compare.
+// It also builds `bench_asan` with -fsanitize=address and runs `bench_asan
+// pool`, which only does the worker pool restart check.
+//
+
+template<typename F>
+double bestOf( int runs, F f )
+{
+	double best = 1e9;
+	for( int i = 0; i < runs; ++i )
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min( best, std::chrono::duration<double, std::milli>( end - start ).count() );
+	}
+	return best;
+}
+
+float randomFloat( float min, float max )
+{
+	return min + ( rand() / (float)RAND_MAX ) * ( max - min );
+}
+
+void benchMath()
+{
+	const int count = 100000;
+	const int runs = 20;
+
+	std::vector<vec3> a3( count ), b3( count ), out3( count );
+	std::vector<vec4> a4( count ), b4( count ), out4( count );
+	std::vector<float> dots( count );
+	std::vector<quat> qa( count ), qb( count ), qout( count );
+	std::vector<mat4> ma( count / 10 ), mb( count / 10 ), mout( count / 10 );
+
+	for( int i = 0; i < count; ++i )
+	{
+		a3[i] = vec3( randomFloat( -1, 1 ), randomFloat( -1, 1 ), randomFloat( -1, 1 ) );
+		b3[i] = vec3( randomFloat( -1, 1 ), randomFloat( -1, 1 ), randomFloat( -1, 1 ) );
+		a4[i] = vec4( a3[i], 1.0f );
+		b4[i] = vec4( b3[i], 0.0f );
+		qa[i] = quat::axisAngle( a3[i].normal(), randomFloat( -3, 3 ) );
+		qb[i] = quat::axisAngle( b3[i].normal(), randomFloat( -3, 3 ) );
+	}
+
+	for( size_t i = 0; i < ma.size(); ++i )
+	{
+		ma[i] = mat4::translation( a3[i] ) * mat4::rotation( qa[i] );
+		mb[i] = mat4::rotation( qb[i] ) * mat4::scale( b3[i] );
+	}
+
+	const mat4 m = ma[0];
+
+#ifdef TJH_MATH_FAST
+	const char* fast = ", fast vec2/vec3 (TJH_MATH_FAST)";
+#else
+	const char* fast = "";
+#endif
+	printf( "tjh_math %s%s, %d items, best of %d\n", TJH_MATH_SSE ? "SSE" : "scalar (TJH_MATH_NO_SIMD)", fast, count, runs );
+
+	auto report = [&]( const char* name, double ms, int n ) {
+		printf( "  %-22s %7.3f ms  %6.2f ns each\n", name, ms, ms * 1e6 / n );
+	};
+
+	report( "vec3 dot", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) dots[i] = a3[i].dot( b3[i] ); } ), count );
+	report( "vec4 dot", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) dots[i] = a4[i].dot( b4[i] ); } ), count );
+	report( "vec3 cross", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out3[i] = a3[i].cross( b3[i] ); } ), count );
+	report( "vec4 cross", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out4[i] = a4[i].cross( b4[i] ); } ), count );
+	report( "vec3 normal", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out3[i] = a3[i].normal(); } ), count );
+	report( "vec4 normal", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out4[i] = a4[i].normal(); } ), count );
+	report( "mat4 * vec4", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out4[i] = m * a4[i]; } ), count );
+	report( "mat4 * mat4", bestOf( runs, [&]() { for( size_t i = 0; i < ma.size(); ++i ) mout[i] = ma[i] * mb[i]; } ), (int)ma.size() );
+	report( "quat * quat", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) qout[i] = qa[i] * qb[i]; } ), count );
+	report( "quat rotate", bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out4[i] = qa[i].rotate( a4[i] ); } ), count );
+}
+
+void benchFastMath()
+{
+	const int count = 100000;
+	const int runs = 20;
+
+	std::vector<float> values( count ), ys( count ), xs( count ), out( count ), out2( count );
+	for( int i = 0; i < count; ++i )
+	{
+		values[i] = randomFloat( 0.001f, 1000.0f );
+		ys[i] = randomFloat( -10, 10 );
+		xs[i] = randomFloat( -10, 10 );
+	}
+
+	printf( "fast math, %d items, best of %d\n", count, runs );
+
+	double worst = 0;
+	auto check = [&]( const std::vector<float>& a, std::function<double( int )> exact, bool relative )
+	{
+		worst = 0;
+		for( int i = 0; i < count; ++i )
+		{
+			double e = exact( i );
+			worst = std::max( worst, std::fabs( a[i] - e ) / ( relative ? std::fabs( e ) : 1.0 ) );
+		}
+	};
+	auto report = [&]( const char* name, double exact_ms, double fast_ms, double array_ms )
+	{
+		printf( "  %-8s std %6.2f ns  fast %6.2f ns  array %6.2f ns  (%4.1fx)  max error %g\n", name,
+			exact_ms * 1e6 / count, fast_ms * 1e6 / count, array_ms * 1e6 / count, exact_ms / array_ms, worst );
+	};
+
+	double exact_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = 1.0f / std::sqrt( values[i] ); } );
+	double fast_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = fastRsqrt( values[i] ); } );
+	double array_ms = bestOf( runs, [&]() { fastRsqrt( values.data(), out.data(), count ); } );
+	check( out, [&]( int i ) { return 1.0 / std::sqrt( (double)values[i] ); }, true );
+	report( "rsqrt", exact_ms, fast_ms, array_ms );
+
+	exact_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = std::sqrt( values[i] ); } );
+	fast_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = fastSqrt( values[i] ); } );
+	array_ms = bestOf( runs, [&]() { fastSqrt( values.data(), out.data(), count ); } );
+	check( out, [&]( int i ) { return std::sqrt( (double)values[i] ); }, true );
+	report( "sqrt", exact_ms, fast_ms, array_ms );
+
+	exact_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = std::atan2( ys[i], xs[i] ); } );
+	fast_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = fastAtan2( ys[i], xs[i] ); } );
+	array_ms = bestOf( runs, [&]() { fastAtan2( ys.data(), xs.data(), out.data(), count ); } );
+	check( out, [&]( int i ) { return std::atan2( (double)ys[i], (double)xs[i] ); }, false );
+	report( "atan2", exact_ms, fast_ms, array_ms );
+
+	exact_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) { out[i] = std::sin( ys[i] ); out2[i] = std::cos( ys[i] ); } } );
+	fast_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) fastSinCos( ys[i], out[i], out2[i] ); } );
+	array_ms = bestOf( runs, [&]() { fastSinCos( ys.data(), out.data(), out2.data(), count ); } );
+	check( out, [&]( int i ) { return std::sin( (double)ys[i] ); }, false );
+	double sin_worst = worst;
+	check( out2, [&]( int i ) { return std::cos( (double)ys[i] ); }, false );
+	worst = std::max( worst, sin_worst );
+	report( "sin+cos", exact_ms, fast_ms, array_ms );
+}
+
+// The test line_vs_circle used to do, without the drawing
+bool isTouchingOld( vec2 pos, float radius, float x1, float y1, float x2, float y2 )
+{
+	vec2 line( x2 - x1, y2 - y1 );
+	vec2 lineNormalized = line.normalized();
+
+	vec2 lineToCircle( pos.x - x1, pos.y - y1 );
+
+	float closestDist = lineToCircle.dot( lineNormalized );
+	vec2 closestPoint = vec2( x1, y1 ) + lineNormalized * closestDist;
+
+	if( closestDist < 0 )
+	{
+		return pos.distance( {x1, y1} ) < radius;
+	}
+	else if( closestDist > line.length() )
+	{
+		return pos.distance( {x2, y2} ) < radius;
+	}
+
+	return closestPoint.distance( pos ) < radius;
+}
+
+void benchCircleVsSegments()
+{
+	const int num_circles = 1000;
+	const int num_segments = 1000;
+
+	circle_soa circles;
+	segment_soa segments;
+
+	for( int i = 0; i < num_circles; ++i )
+	{
+		circles.add( randomFloat( 0, 1280 ), randomFloat( 0, 720 ), randomFloat( 5, 30 ) );
+	}
+	for( int i = 0; i < num_segments; ++i )
+	{
+		float x = randomFloat( 0, 1280 ), y = randomFloat( 0, 720 );
+		segments.add( x, y, x + randomFloat( -100, 100 ), y + randomFloat( -100, 100 ) );
+	}
+
+	printf( "circles vs segments, %d x %d pairs\n", num_circles, num_segments );
+
+	std::vector<collision_pair> old_hits, scalar_hits, batch_hits;
+	old_hits.reserve( 100000 );
+	scalar_hits.reserve( 100000 );
+	batch_hits.reserve( 100000 );
+
+	double old_ms = bestOf( 5, [&]() {
+		old_hits.clear();
+		for( int i = 0; i < num_circles; ++i )
+			for( int j = 0; j < num_segments; ++j )
+				if( isTouchingOld( vec2( circles.x[i], circles.y[i] ), circles.radius[i], segments.x1[j], segments.y1[j], segments.x2[j], segments.y2[j] ) )
+					old_hits.push_back( { i, j } );
+	} );
+
+	double scalar_ms = bestOf( 5, [&]() {
+		scalar_hits.clear();
+		for( int i = 0; i < num_circles; ++i )
+			circleVsSegmentsScalar( circles, i, segments, 0, num_segments, scalar_hits );
+	} );
+
+	double batch_ms = bestOf( 5, [&]() {
+		batch_hits.clear();
+		circlesVsSegments( circles, segments, batch_hits );
+	} );
+
+	auto same = []( const std::vector<collision_pair>& a, const std::vector<collision_pair>& b ) {
+		if( a.size() != b.size() ) return false;
+		for( size_t i = 0; i < a.size(); ++i )
+			if( a[i].a != b[i].a || a[i].b != b[i].b ) return false;
+		return true;
+	};
+
+	printf( "  normalize + sqrt %7.2f ms   squared %7.2f ms   batch %7.2f ms   %5.1fx   %d hits, %s\n",
+		old_ms, scalar_ms, batch_ms, old_ms / batch_ms, (int)batch_hits.size(),
+		same( scalar_hits, batch_hits ) ? "batch matches scalar" : "MISMATCH" );
+	if( !same( old_hits, batch_hits ) )
+		printf( "  (%d hits with the old test, differences are pairs right on the edge)\n", (int)old_hits.size() );
+}
+
+bool samePairs( std::vector<collision_pair> a, std::vector<collision_pair> b )
+{
+	auto less = []( const collision_pair& p, const collision_pair& q ) { return p.a != q.a ? p.a < q.a : p.b < q.b; };
+	std::sort( a.begin(), a.end(), less );
+	std::sort( b.begin(), b.end(), less );
+	if( a.size() != b.size() ) return false;
+	for( size_t i = 0; i < a.size(); ++i )
+		if( a[i].a != b[i].a || a[i].b != b[i].b ) return false;
+	return true;
+}
+
+// Thousands of moving circles in a level made of short segments
+struct test_level
+{
+	circle_soa circles;
+	std::vector<float> vx, vy;
+	segment_soa segments;
+	float width, height;
+
+	test_level( int num_circles, int num_segments, float w, float h ) : width( w ), height( h )
+	{
+		for( int i = 0; i < num_circles; ++i )
+		{
+			circles.add( randomFloat( 0, w ), randomFloat( 0, h ), randomFloat( 2, 8 ) );
+			vx.push_back( randomFloat( -100, 100 ) );
+			vy.push_back( randomFloat( -100, 100 ) );
+		}
+		for( int i = 0; i < num_segments; ++i )
+		{
+			float x = randomFloat( 0, w ), y = randomFloat( 0, h );
+			segments.add( x, y, x + randomFloat( -50, 50 ), y + randomFloat( -50, 50 ) );
+		}
+	}
+
+	void step( float dt )
+	{
+		for( int i = 0; i < circles.size(); ++i )
+		{
+			circles.x[i] += vx[i] * dt;
+			circles.y[i] += vy[i] * dt;
+			if( circles.x[i] < 0 || circles.x[i] > width ) vx[i] = -vx[i];
+			if( circles.y[i] < 0 || circles.y[i] > height ) vy[i] = -vy[i];
+		}
+	}
+};
+
+void benchBroadphase()
+{
+	const int num_circles = 10000;
+	const int num_segments = 2000;
+	const int frames = 60;
+
+	test_level level( num_circles, num_segments, 4000, 4000 );
+
+	printf( "broadphase, %d moving circles, %d static segments, %d frames\n", num_circles, num_segments, frames );
+
+	segment_grid grid;
+	double build_ms = bestOf( 1, [&]() { buildSegmentGrid( grid, level.segments, 32.0f ); } );
+
+	sweep_and_prune sap;
+	sapUpdate( sap, level.circles );
+
+	std::vector<collision_pair> candidates, hits, circle_candidates, circle_hits;
+	double grid_ms = 0, sap_update_ms = 0, sap_pairs_ms = 0, narrow_ms = 0;
+	size_t total_candidates = 0, total_circle_candidates = 0;
+
+	for( int f = 0; f < frames; ++f )
+	{
+		level.step( 1.0f / 60.0f );
+
+		candidates.clear(); hits.clear(); circle_candidates.clear(); circle_hits.clear();
+
+		grid_ms += bestOf( 1, [&]() { gridCandidates( grid, level.circles, candidates ); } );
+		sap_update_ms += bestOf( 1, [&]() { sapUpdate( sap, level.circles ); } );
+		sap_pairs_ms += bestOf( 1, [&]() { sapPairs( sap, level.circles, circle_candidates ); } );
+		narrow_ms += bestOf( 1, [&]() {
+			circlesVsSegments( level.circles, level.segments, candidates, hits );
+			circlesVsCircles( level.circles, circle_candidates, circle_hits );
+		} );
+
+		total_candidates += candidates.size();
+		total_circle_candidates += circle_candidates.size();
+	}
+
+	// All pairs on the last frame, to check against and compare with
+	std::vector<collision_pair> brute_hits, brute_circle_hits;
+	double brute_ms = bestOf( 1, [&]() { circlesVsSegments( level.circles, level.segments, brute_hits ); } );
+	double brute_circles_ms = bestOf( 1, [&]() {
+		const circle_soa& c = level.circles;
+		for( int a = 0; a < c.size(); ++a )
+			for( int b = a + 1; b < c.size(); ++b )
+			{
+				float dx = c.x[b] - c.x[a], dy = c.y[b] - c.y[a], r = c.radius[a] + c.radius[b];
+				if( dx*dx + dy*dy < r*r ) brute_circle_hits.push_back( { a, b } );
+			}
+	} );
+
+	// Contacts for the last frame's candidates, sized once up front
+	contact_buffer contacts;
+	contacts.reserve( 1 << 16 );
+	double contacts_ms = bestOf( 10, [&]() {
+		contacts.clear();
+		circlesVsSegments( level.circles, level.segments, candidates, contacts );
+		circlesVsCircles( level.circles, circle_candidates, contacts );
+	} );
+	double bools_ms = bestOf( 10, [&]() {
+		hits.clear(); circle_hits.clear();
+		circlesVsSegments( level.circles, level.segments, candidates, hits );
+		circlesVsCircles( level.circles, circle_candidates, circle_hits );
+	} );
+
+	printf( "  grid build %6.2f ms\n", build_ms );
+	printf( "  per frame: grid %6.3f ms   sap update %6.3f ms   sap pairs %6.3f ms   narrowphase %6.3f ms\n",
+		grid_ms / frames, sap_update_ms / frames, sap_pairs_ms / frames, narrow_ms / frames );
+	printf( "  candidates per frame: %d circle/segment, %d circle/circle\n",
+		(int)( total_candidates / frames ), (int)( total_circle_candidates / frames ) );
+	printf( "  all pairs: segments (SIMD) %6.2f ms   circles %6.2f ms   results %s\n", brute_ms, brute_circles_ms,
+		samePairs( hits, brute_hits ) && samePairs( circle_hits, brute_circle_hits ) ? "match" : "MISMATCH" );
+	printf( "  contacts %6.3f ms (%d, %d dropped)   touching only %6.3f ms (%d)\n",
+		contacts_ms, contacts.count, contacts.dropped, bools_ms, (int)( hits.size() + circle_hits.size() ) );
+}
+
+void benchSweep()
+{
+	const int num_circles = 10000;
+	const int num_segments = 2000;
+	const int frames = 60;
+	const float dt = 1.0f / 20.0f;	// A big step, circles move up to 50 px a frame
+
+	test_level level( num_circles, num_segments, 4000, 4000 );
+	for( int i = 0; i < num_circles; ++i ) { level.vx[i] *= 10.0f; level.vy[i] *= 10.0f; }
+
+	printf( "swept circles, %d circles, %d segments, %d frames of %.0f ms\n", num_circles, num_segments, frames, dt * 1000.0f );
+
+	segment_grid grid;
+	buildSegmentGrid( grid, level.segments, 32.0f );
+
+	std::vector<float> move_x( num_circles ), move_y( num_circles );
+	std::vector<collision_pair> candidates, end_candidates, end_hits;
+	std::vector<sweep_hit> hits;
+	std::vector<bool> touching_at_end( num_circles );
+
+	double candidates_ms = 0, sweep_ms = 0;
+	size_t total_candidates = 0, total_hits = 0, tunnelled = 0;
+
+	for( int f = 0; f < frames; ++f )
+	{
+		for( int i = 0; i < num_circles; ++i ) { move_x[i] = level.vx[i] * dt; move_y[i] = level.vy[i] * dt; }
+
+		candidates.clear(); hits.clear();
+		candidates_ms += bestOf( 1, [&]() { gridSweptCandidates( grid, level.circles, move_x, move_y, candidates ); } );
+		sweep_ms += bestOf( 1, [&]() { sweepCirclesVsSegments( level.circles, move_x, move_y, level.segments, candidates, hits ); } );
+
+		total_candidates += candidates.size();
+		total_hits += hits.size();
+
+		level.step( dt );
+
+		// Hits that a test at the end of the step would have missed
+		end_candidates.clear(); end_hits.clear();
+		gridCandidates( grid, level.circles, end_candidates );
+		circlesVsSegments( level.circles, level.segments, end_candidates, end_hits );
+
+		std::fill( touching_at_end.begin(), touching_at_end.end(), false );
+		for( const collision_pair& p : end_hits ) touching_at_end[p.a] = true;
+		for( const sweep_hit& h : hits ) tunnelled += h.toi > 0.0f && !touching_at_end[h.a];
+	}
+
+	printf( "  per frame: swept candidates %6.3f ms (%d)   sweep %6.3f ms (%d hits, %d missed by the end of step test)\n",
+		candidates_ms / frames, (int)( total_candidates / frames ), sweep_ms / frames, (int)( total_hits / frames ), (int)( tunnelled / frames ) );
+}
+
+bool sameContacts( const contact_buffer& a, const contact_buffer& b )
+{
+	return a.count == b.count && a.dropped == b.dropped && memcmp( a.contacts.data(), b.contacts.data(), a.count * sizeof( contact ) ) == 0;
+}
+
+void benchParallelNarrowphase()
+{
+	const int num_circles = 100000;
+	const int num_segments = 20000;
+	const int runs = 10;
+
+	test_level level( num_circles, num_segments, 8000, 8000 );
+
+	segment_grid grid;
+	buildSegmentGrid( grid, level.segments, 32.0f );
+	std::vector<collision_pair> candidates, circle_candidates;
+	gridCandidates( grid, level.circles, candidates );
+
+	sweep_and_prune sap;
+	sapUpdate( sap, level.circles );
+	sapPairs( sap, level.circles, circle_candidates );
+
+	printf( "parallel narrowphase, %d circle/segment and %d circle/circle pairs, %d hardware threads\n",
+		(int)candidates.size(), (int)circle_candidates.size(), (int)std::thread::hardware_concurrency() );
+
+	contact_buffer serial;
+	serial.reserve( 1 << 20 );
+	double serial_ms = bestOf( runs, [&]() {
+		serial.clear();
+		circlesVsSegments( level.circles, level.segments, candidates, serial );
+		circlesVsCircles( level.circles, circle_candidates, serial );
+	} );
+	printf( "  single threaded %6.2f ms (%d contacts)\n", serial_ms, serial.count );
+
+	worker_pool pool;
+	narrowphase_buffers buffers;
+	contact_buffer contacts;
+	contacts.reserve( 1 << 20 );
+
+	const int worker_counts[] = { 1, 2, 4, 8 };
+	for( int workers : worker_counts )
+	{
+		poolStart( pool, workers );
+		double ms = bestOf( runs, [&]() {
+			contacts.clear();
+			circlesVsSegmentsParallel( pool, buffers, level.circles, level.segments, candidates, contacts );
+			circlesVsCirclesParallel( pool, buffers, level.circles, circle_candidates, contacts );
+		} );
+		printf( "  %d workers %6.2f ms   %.2fx   results %s\n", workers, ms, serial_ms / ms, sameContacts( serial, contacts ) ? "match" : "MISMATCH" );
+	}
+	poolStop( pool );
+}
+
+// Restarts the pool with different numbers of workers, giving the helpers
+// time to wake each time. They used to start up thinking they'd missed the
+// last job and run it again, long after it had gone. Run under ASan.
+void benchPoolRestart()
+{
+	const int count = 1000;
+	const int worker_counts[] = { 2, 4, 1, 8, 3, 2 };
+
+	worker_pool pool;
+	bool ok = true;
+	for( int workers : worker_counts )
+	{
+		poolStart( pool, workers );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+
+		for( int run = 0; run < 3; ++run )
+		{
+			std::vector<int> done( count, 0 );
+			poolFor( pool, count, [&]( int, int i ) { done[i]++; } );
+			ok = ok && std::count( done.begin(), done.end(), 1 ) == count;
+		}
+	}
+	poolStop( pool );
+
+	printf( "worker pool restarts: %s\n", ok ? "ok" : "WRONG" );
+}
+
+aabb2 circleBox( const circle_soa& c, int i )
+{
+	return aabb2( vec2( c.x[i] - c.radius[i], c.y[i] - c.radius[i] ), vec2( c.x[i] + c.radius[i], c.y[i] + c.radius[i] ) );
+}
+
+void benchAabbTree()
+{
+	const int num_circles = 100000;
+	const int frames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	// Same density as benchBroadphase, the segments aren't used
+	test_level level( num_circles, 0, 12600, 12600 );
+	const circle_soa& c = level.circles;
+
+	printf( "aabb tree, %d moving circles, %d frames\n", num_circles, frames );
+
+	aabb_tree tree;
+	std::vector<int> proxies( num_circles );
+	double build_ms = bestOf( 1, [&]() {
+		for( int i = 0; i < num_circles; ++i )
+			proxies[i] = treeCreateProxy( tree, circleBox( c, i ), i );
+	} );
+
+	std::vector<collision_pair> pairs;
+	double first_pairs_ms = bestOf( 1, [&]() { treeMovedPairs( tree, pairs ); } );
+	int build_height = treeHeight( tree );
+
+	double move_ms = 0, pairs_ms = 0;
+	size_t reinserted = 0, new_pairs = 0;
+
+	for( int f = 0; f < frames; ++f )
+	{
+		level.step( dt );
+
+		move_ms += bestOf( 1, [&]() {
+			for( int i = 0; i < num_circles; ++i )
+				reinserted += treeMoveProxy( tree, proxies[i], circleBox( c, i ), vec2( level.vx[i] * dt, level.vy[i] * dt ) );
+		} );
+
+		pairs.clear();
+		pairs_ms += bestOf( 1, [&]() { treeMovedPairs( tree, pairs ); } );
+		new_pairs += pairs.size();
+	}
+
+	// Box queries and rays about the size of a view and a line of sight
+	const int num_queries = 10000;
+	std::vector<aabb2> query_boxes;
+	std::vector<vec2> ray_from, ray_to;
+	for( int i = 0; i < num_queries; ++i )
+	{
+		vec2 p( randomFloat( 0, 12600 ), randomFloat( 0, 12600 ) );
+		query_boxes.push_back( aabb2( p, p + vec2( 100, 100 ) ) );
+		ray_from.push_back( p );
+		ray_to.push_back( p + vec2( randomFloat( -500, 500 ), randomFloat( -500, 500 ) ) );
+	}
+
+	size_t query_hits = 0, ray_hits = 0;
+	double query_ms = bestOf( 1, [&]() {
+		for( const aabb2& box : query_boxes )
+			treeQuery( tree, box, [&]( int ) { query_hits++; return true; } );
+	} );
+
+	// Nearest circle along each ray
+	double ray_ms = bestOf( 1, [&]() {
+		for( int i = 0; i < num_queries; ++i )
+		{
+			vec2 from = ray_from[i], d = ray_to[i] - ray_from[i];
+			int nearest = -1;
+			treeRayCast( tree, ray_from[i], ray_to[i], [&]( int proxy, float max_fraction ) {
+				int j = tree.nodes[proxy].user;
+				vec2 f( from.x - c.x[j], from.y - c.y[j] );
+				float a = d.dot( d ), b = f.dot( d ), k = f.dot( f ) - c.radius[j] * c.radius[j];
+				float disc = b*b - a*k;
+				if( disc < 0.0f ) return max_fraction;
+				float t = ( -b - std::sqrt( disc ) ) / a;
+				if( t < 0.0f || t > max_fraction ) return max_fraction;
+				nearest = j;
+				return t;
+			} );
+			ray_hits += nearest >= 0;
+		}
+	} );
+
+	// Every pair of circles with overlapping boxes should come out of a query,
+	// check against sweep and prune on the last frame
+	std::vector<collision_pair> sap_pairs, tree_pairs;
+	sweep_and_prune sap;
+	sapUpdate( sap, c );
+	sapPairs( sap, c, sap_pairs );
+	for( int i = 0; i < num_circles; ++i )
+	{
+		aabb2 box = circleBox( c, i );
+		treeQuery( tree, box, [&]( int proxy ) {
+			int j = tree.nodes[proxy].user;
+			if( j > i && box.overlaps( circleBox( c, j ) ) ) tree_pairs.push_back( { i, j } );
+			return true;
+		} );
+	}
+
+	printf( "  build %6.2f ms   first pairs %6.2f ms   height %d, after moving %d\n", build_ms, first_pairs_ms, build_height, treeHeight( tree ) );
+	printf( "  per frame: move %6.3f ms (%d reinserted)   pairs %6.3f ms (%d new)\n",
+		move_ms / frames, (int)( reinserted / frames ), pairs_ms / frames, (int)( new_pairs / frames ) );
+	printf( "  %d box queries %6.2f ms (%d found)   %d rays %6.2f ms (%d hit)\n",
+		num_queries, query_ms, (int)query_hits, num_queries, ray_ms, (int)ray_hits );
+	printf( "  overlaps vs sweep and prune: %s\n", samePairs( tree_pairs, sap_pairs ) ? "match" : "MISMATCH" );
+}
+
+bool sameRayHits( const std::vector<ray_hit>& a, const std::vector<ray_hit>& b )
+{
+	if( a.size() != b.size() ) return false;
+	for( size_t i = 0; i < a.size(); ++i )
+	{
+		// A different thing at the same distance is a tie, not a mistake
+		if( ( a[i].segment != b[i].segment || a[i].circle != b[i].circle ) && std::fabs( a[i].t - b[i].t ) > 1e-5f )
+			return false;
+	}
+	return true;
+}
+
+void benchRaycast()
+{
+	const int num_circles = 20000;
+	const int num_segments = 20000;
+	const int num_rays = 2000;
+	const int runs = 10;
+
+	test_level level( num_circles, num_segments, 8000, 8000 );
+
+	segment_grid grid;
+	buildSegmentGrid( grid, level.segments, 32.0f );
+	segment_cells cells;
+	buildSegmentCells( cells, grid, level.segments );
+
+	aabb_tree tree;
+	for( int i = 0; i < num_circles; ++i )
+		treeCreateProxy( tree, circleBox( level.circles, i ), i );
+
+	// Line of sight from agents (the first circles) to points up to 600 away
+	ray_soa rays;
+	for( int i = 0; i < num_rays; ++i )
+		rays.add( level.circles.x[i], level.circles.y[i], randomFloat( -600, 600 ), randomFloat( -600, 600 ) );
+
+	printf( "ray casts, %d rays vs %d segments and %d circles\n", num_rays, num_segments, num_circles );
+
+	// Every ray against everything
+	std::vector<ray_hit> brute;
+	double brute_ms = bestOf( 1, [&]() {
+		clearRayHits( brute, num_rays );
+		for( int i = 0; i < num_rays; ++i )
+		{
+			ray_hit& h = brute[i];
+			for( int j = 0; j < num_segments; ++j )
+			{
+				float t = rayVsSegment( rays.x[i], rays.y[i], rays.dx[i], rays.dy[i], level.segments.x1[j], level.segments.y1[j], level.segments.x2[j], level.segments.y2[j] );
+				if( t >= 0.0f && t < h.t ) { h.t = t; h.segment = j; h.circle = -1; }
+			}
+			for( int j = 0; j < num_circles; ++j )
+			{
+				float t = rayVsCircle( rays.x[i], rays.y[i], rays.dx[i], rays.dy[i], level.circles.x[j], level.circles.y[j], level.circles.radius[j] );
+				if( t >= 0.0f && t < h.t ) { h.t = t; h.circle = j; h.segment = -1; }
+			}
+		}
+	} );
+	int hit_count = 0;
+	for( const ray_hit& h : brute ) hit_count += h.segment >= 0 || h.circle >= 0;
+	printf( "  brute force   %8.3f ms  (%d hit something)\n", brute_ms, hit_count );
+
+	worker_pool pool;
+	std::vector<ray_hit> hits;
+
+	const int worker_counts[] = { 1, 2, 4 };
+	for( int workers : worker_counts )
+	{
+		poolStart( pool, workers );
+		double segment_ms = bestOf( runs, [&]() { clearRayHits( hits, num_rays ); raycastSegments( pool, grid, cells, rays, hits ); } );
+		double ms = bestOf( runs, [&]() {
+			clearRayHits( hits, num_rays );
+			raycastSegments( pool, grid, cells, rays, hits );
+			raycastCircles( pool, tree, level.circles, rays, hits );
+		} );
+		printf( "  %d workers     %8.3f ms  (segments %.3f ms)  %5.1f us per ray  %.0fx   results %s\n", workers, ms, segment_ms,
+			ms * 1e3 / num_rays, brute_ms / ms, sameRayHits( brute, hits ) ? "match" : "MISMATCH" );
+	}
+	poolStop( pool );
+}
+
+vec3 randomVec3( float min, float max )
+{
+	return vec3( randomFloat( min, max ), randomFloat( min, max ), randomFloat( min, max ) );
+}
+
+obb randomObb( float spread )
+{
+	obb b;
+	b.center = randomVec3( -spread, spread );
+	mat4 r = mat4::rotation( quat::axisAngle( randomVec3( -1, 1 ).normal(), randomFloat( 0, TWO_PI ) ) );
+	for( int i = 0; i < 3; ++i ) b.axis[i] = r.c[i].xyz();
+	b.half = randomVec3( 0.2f, 1.0f );
+	return b;
+}
+
+void bench3d()
+{
+	const int count = 100000;
+	const int runs = 10;
+	const float spread = 3.0f;
+
+	std::vector<sphere> spheres;
+	std::vector<aabb3> boxes;
+	std::vector<obb> obbs;
+	std::vector<triangle> triangles;
+	for( int i = 0; i < count + 1; ++i )
+	{
+		spheres.push_back( { randomVec3( -spread, spread ), randomFloat( 0.2f, 1.0f ) } );
+		vec3 c = randomVec3( -spread, spread ), h = randomVec3( 0.2f, 1.0f );
+		boxes.push_back( aabb3( c - h, c + h ) );
+		obbs.push_back( randomObb( spread ) );
+		vec3 t = randomVec3( -spread, spread );
+		triangles.push_back( { t, t + randomVec3( -1, 1 ), t + randomVec3( -1, 1 ) } );
+	}
+
+	printf( "3d, %d pairs of each\n", count );
+
+	contact3 c;
+	int hits = 0;
+	auto report = [&]( const char* name, double ms ) { printf( "  %-16s %6.2f ms  %5.1f ns each  (%d hits)\n", name, ms, ms * 1e6 / count, hits ); hits = 0; };
+
+	report( "sphere/sphere", bestOf( runs, [&]() { hits = 0; for( int i = 0; i < count; ++i ) hits += sphereVsSphere( spheres[i], spheres[i + 1], c ); } ) );
+	report( "sphere/aabb", bestOf( runs, [&]() { hits = 0; for( int i = 0; i < count; ++i ) hits += sphereVsAabb( spheres[i], boxes[i], c ); } ) );
+	report( "aabb/aabb", bestOf( runs, [&]() { hits = 0; for( int i = 0; i < count; ++i ) hits += aabbVsAabb( boxes[i], boxes[i + 1], c ); } ) );
+	report( "obb/obb SAT", bestOf( runs, [&]() { hits = 0; for( int i = 0; i < count; ++i ) hits += obbVsObb( obbs[i], obbs[i + 1], c ); } ) );
+	report( "sphere/triangle", bestOf( runs, [&]() { hits = 0; for( int i = 0; i < count; ++i ) hits += sphereVsTriangle( spheres[i], triangles[i], c ); } ) );
+
+	std::vector<gjk_cache> caches( count );
+	report( "obb/obb GJK+EPA", bestOf( runs, [&]() {
+		hits = 0;
+		for( int i = 0; i < count; ++i ) { caches[i].axis = vec3(); hits += convexVsConvex( obbs[i], obbs[i + 1], caches[i], c ); }
+	} ) );
+
+	// GJK+EPA depth against the exact tests. The aligned and offset ones start
+	// GJK with the origin on a point or line of A - B, which has to be filled
+	// out to a tetrahedron before EPA can find the depth.
+	{
+		double box_worst = 0, sphere_worst = 0;
+		int mismatches = 0;
+		contact3 exact;
+		for( int i = 0; i < count; ++i )
+		{
+			aabb3 a = boxes[i], b = boxes[i + 1];
+			vec3 h = b.extents();
+			if( i % 3 == 0 ) b = aabb3( a.center() - h, a.center() + h );
+			else if( i % 3 == 1 ) { vec3 o = a.center(); o.e[i % 3] += randomFloat( -1, 1 ); b = aabb3( o - h, o + h ); }
+
+			gjk_cache fresh = { vec3() };
+			bool hit = convexVsConvex( a, b, fresh, c );
+			if( hit != aabbVsAabb( a, b, exact ) ) mismatches++;
+			else if( hit ) box_worst = std::max( box_worst, (double)std::fabs( c.depth - exact.depth ) );
+
+			sphere sa = spheres[i], sb = spheres[i + 1];
+			sb.center = sa.center;
+			if( i % 2 ) sb.center.e[i % 3] += randomFloat( -0.5f, 0.5f );
+			fresh.axis = vec3();
+			hit = convexVsConvex( sa, sb, fresh, c );
+			if( hit != sphereVsSphere( sa, sb, exact ) ) mismatches++;
+			else if( hit ) sphere_worst = std::max( sphere_worst, (double)std::fabs( c.depth - exact.depth ) );
+		}
+		printf( "  GJK+EPA depth vs exact, aligned and offset: boxes worst %g, spheres worst %g  hits %s\n",
+			box_worst, sphere_worst, mismatches == 0 ? "match" : "MISMATCH" );
+	}
+
+	// Hulls drifting past each other, the cached axis carried from one frame
+	// to the next or thrown away each time
+	const int num_hulls = 2000;
+	const int frames = 60;
+	std::vector<convex_hull> hulls( num_hulls );
+	std::vector<vec3> velocity( num_hulls );
+	for( int i = 0; i < num_hulls; ++i )
+	{
+		vec3 center = randomVec3( -spread * 4, spread * 4 );
+		for( int k = 0; k < 32; ++k ) hulls[i].add( center + randomVec3( -1, 1 ) );
+		velocity[i] = randomVec3( -0.02f, 0.02f );
+	}
+
+	auto moveHulls = [&]()
+	{
+		for( int i = 0; i < num_hulls; ++i )
+			for( int k = 0; k < hulls[i].size(); ++k )
+			{
+				hulls[i].x[k] += velocity[i].x; hulls[i].y[k] += velocity[i].y; hulls[i].z[k] += velocity[i].z;
+			}
+	};
+
+	// Each hull against the next 50
+	const int neighbours = 50;
+	std::vector<gjk_cache> warm( num_hulls * neighbours );
+	double cold_ms = 0, warm_ms = 0;
+	int cold_hits = 0, warm_hits = 0;
+	for( int f = 0; f < frames; ++f )
+	{
+		moveHulls();
+		cold_ms += bestOf( 1, [&]() {
+			for( int i = 0; i < num_hulls; ++i )
+				for( int n = 1; n <= neighbours; ++n )
+				{
+					gjk_cache fresh = { vec3() };
+					cold_hits += convexVsConvex( hulls[i], hulls[( i + n ) % num_hulls], fresh, c );
+				}
+		} );
+		warm_ms += bestOf( 1, [&]() {
+			for( int i = 0; i < num_hulls; ++i )
+				for( int n = 1; n <= neighbours; ++n )
+					warm_hits += convexVsConvex( hulls[i], hulls[( i + n ) % num_hulls], warm[i * neighbours + n - 1], c );
+		} );
+	}
+
+	printf( "  32 point hulls, %d pairs, %d frames: cold %6.2f ms per frame, warm started %6.2f ms  (%.1fx)   hits %s\n",
+		num_hulls * neighbours, frames, cold_ms / frames, warm_ms / frames, cold_ms / warm_ms, cold_hits == warm_hits ? "match" : "MISMATCH" );
+}
+
+// The same work in float and both fixed point types. Worst difference from
+// float is printed alongside, float is the reference, not the truth.
+template<typename T>
+void benchFixedType( const char* name, float scale )
+{
+	const int count = 100000;
+	const int runs = 10;
+
+	std::vector<float> values( count ), angles( count ), xs( count ), ys( count ), radii( count );
+	std::vector<T> qvalues( count ), qangles( count ), qxs( count ), qys( count ), qradii( count );
+	for( int i = 0; i < count; ++i )
+	{
+		values[i] = randomFloat( 0, 100 * scale );
+		angles[i] = randomFloat( -10, 10 );
+		xs[i] = randomFloat( -scale, scale );
+		ys[i] = randomFloat( -scale, scale );
+		qvalues[i] = T( values[i] ); qangles[i] = T( angles[i] );
+		qxs[i] = T( xs[i] ); qys[i] = T( ys[i] );
+
+		// Scaled in float then converted once, T( 0.001f ) alone is 0.7% off in q16
+		radii[i] = values[i] * 0.001f; qradii[i] = T( radii[i] );
+	}
+
+	std::vector<float> out( count ), out2( count );
+	std::vector<T> qout( count ), qout2( count );
+	std::vector<vec2> vout( count );
+	std::vector<qvec2<T>> qvout( count );
+
+	auto report = [&]( const char* test, double float_ms, double fixed_ms, double error )
+	{
+		printf( "  %-14s float %6.2f ns  %s %6.2f ns  (%4.1fx)  max diff %g\n", test,
+			float_ms * 1e6 / count, name, fixed_ms * 1e6 / count, fixed_ms / float_ms, error );
+	};
+
+	auto maxDiff = [&]( const std::vector<float>& a, const std::vector<T>& b )
+	{
+		double worst = 0;
+		for( int i = 0; i < count; ++i ) worst = std::max( worst, std::fabs( (double)a[i] - b[i].toDouble() ) );
+		return worst;
+	};
+
+	double f_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = std::sqrt( values[i] ); } );
+	double q_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) qout[i] = sqrt( qvalues[i] ); } );
+	report( "sqrt", f_ms, q_ms, maxDiff( out, qout ) );
+
+	f_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) { out[i] = std::sin( angles[i] ); out2[i] = std::cos( angles[i] ); } } );
+	q_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) { qout[i] = sin( qangles[i] ); qout2[i] = cos( qangles[i] ); } } );
+	report( "sin + cos", f_ms, q_ms, std::max( maxDiff( out, qout ), maxDiff( out2, qout2 ) ) );
+
+	f_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) out[i] = std::atan2( ys[i], xs[i] ); } );
+	q_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) qout[i] = atan2( qys[i], qxs[i] ); } );
+	report( "atan2", f_ms, q_ms, maxDiff( out, qout ) );
+
+	f_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) vout[i] = vec2( xs[i], ys[i] ).normalized(); } );
+	q_ms = bestOf( runs, [&]() { for( int i = 0; i < count; ++i ) qvout[i] = qvec2<T>( qxs[i], qys[i] ).normalized(); } );
+	for( int i = 0; i < count; ++i ) { out[i] = vout[i].x; qout[i] = qvout[i].x; }
+	report( "vec2 normalize", f_ms, q_ms, maxDiff( out, qout ) );
+
+	// Circles near segments, so about half touch
+	int hits = 0, qhits = 0;
+	f_ms = bestOf( runs, [&]() {
+		hits = 0;
+		contact c;
+		for( int i = 0; i + 2 < count; ++i )
+			if( circleSegmentContact( xs[i], ys[i], radii[i], xs[i + 1], ys[i + 1], xs[i + 2], ys[i + 2], c ) ) { hits++; out[i] = c.depth; }
+	} );
+	q_ms = bestOf( runs, [&]() {
+		qhits = 0;
+		qcontact<T> c;
+		for( int i = 0; i + 2 < count; ++i )
+			if( circleSegmentContact( qxs[i], qys[i], qradii[i], qxs[i + 1], qys[i + 1], qxs[i + 2], qys[i + 2], c ) ) { qhits++; qout[i] = c.depth; }
+	} );
+	printf( "  %-14s float %6.2f ns  %s %6.2f ns  (%4.1fx)  hits %d / %d\n", "circle/segment",
+		f_ms * 1e6 / count, name, q_ms * 1e6 / count, q_ms / f_ms, hits, qhits );
+}
+
+void benchFixed()
+{
+	printf( "fixed point vs float, %s multiply\n", TJH_FIXED_INT128 ? "128 bit" : "portable 64 bit" );
+
+	// Each at a scale where squared lengths stay in range
+	benchFixedType<q16>( "q16", 10.0f );
+	benchFixedType<q32>( "q32", 1000.0f );
+}
+
+int main( int argc, char** argv )
+{
+	if( argc > 1 && strcmp( argv[1], "pool" ) == 0 )
+	{
+		benchPoolRestart();
+		return 0;
+	}
+
+	benchMath();
+	benchFastMath();
+	benchCircleVsSegments();
+	benchBroadphase();
+	benchSweep();
+	benchParallelNarrowphase();
+	benchPoolRestart();
+	benchAabbTree();
+	benchRaycast();
+	bench3d();
+	benchFixed();
+	return 0;
+}
@@ -0,0 +1,129 @@
+#define TJH_DRAW_IMPLEMENTATION
+#include "../tjh_draw.h"
+
+#include "../tjh_math.h"
+#include "../tjh_broadphase.h"
+
+#include <cstdlib>
+
+const int WIDTH = 1280;
+const int HEIGHT = 720;
+
+const int NUM_CIRCLES = 2000;
+const int NUM_SEGMENTS = 200;
+
+float randomFloat( float min, float max )
+{
+	return min + ( rand() / (float)RAND_MAX ) * ( max - min );
+}
+
+int main()
+{
+	draw::init("broadphase", WIDTH, HEIGHT );
+
+	char buf[256];
+	int textHeight = 12;
+
+	circle_soa circles;
+	std::vector<float> vx, vy;
+	for( int i = 0; i < NUM_CIRCLES; ++i )
+	{
+		circles.add( randomFloat( 0, WIDTH ), randomFloat( 0, HEIGHT ), randomFloat( 2, 6 ) );
+		vx.push_back( randomFloat( -60, 60 ) );
+		vy.push_back( randomFloat( -60, 60 ) );
+	}
+
+	segment_soa segments;
+	for( int i = 0; i < NUM_SEGMENTS; ++i )
+	{
+		float x = randomFloat( 0, WIDTH ), y = randomFloat( 0, HEIGHT );
+		segments.add( x, y, x + randomFloat( -80, 80 ), y + randomFloat( -80, 80 ) );
+	}
+
+	segment_grid grid;
+	buildSegmentGrid( grid, segments, 32.0f );
+
+	sweep_and_prune sap;
+
+	std::vector<collision_pair> candidates, circleCandidates;
+	contact_buffer contacts;
+	contacts.reserve( 16384 );
+	std::vector<bool> touching( NUM_CIRCLES );
+
+	Uint64 prevTime = SDL_GetPerformanceCounter();
+
+	bool done = false;
+	while( !done )
+	{
+		SDL_Event event;
+		while( SDL_PollEvent( &event ) ) {
+			if( event.type == SDL_QUIT ) done = true;
+			else if( event.type == SDL_KEYDOWN
+				&& event.key.keysym.scancode == SDL_SCANCODE_ESCAPE ) done = true;
+		}
+
+		Uint64 time = SDL_GetPerformanceCounter();
+		float dt = std::min( (time - prevTime) / (float)SDL_GetPerformanceFrequency(), 0.1f );
+		prevTime = time;
+
+		for( int i = 0; i < NUM_CIRCLES; ++i )
+		{
+			circles.x[i] += vx[i] * dt;
+			circles.y[i] += vy[i] * dt;
+			if( circles.x[i] < 0 || circles.x[i] > WIDTH ) vx[i] = -vx[i];
+			if( circles.y[i] < 0 || circles.y[i] > HEIGHT ) vy[i] = -vy[i];
+		}
+
+		candidates.clear(); circleCandidates.clear(); contacts.clear();
+
+		gridCandidates( grid, circles, candidates );
+		circlesVsSegments( circles, segments, candidates, contacts );
+		int segmentContacts = contacts.count;
+
+		sapUpdate( sap, circles );
+		sapPairs( sap, circles, circleCandidates );
+		circlesVsCircles( circles, circleCandidates, contacts );
+
+		std::fill( touching.begin(), touching.end(), false );
+		for( int k = 0; k < contacts.count; ++k )
+		{
+			const contact& c = contacts.contacts[k];
+			touching[c.a] = true;
+			if( k >= segmentContacts ) touching[c.b] = true;
+		}
+
+		draw::clear( 0.1, 0.1, 0.1 );
+
+		draw::setColor( 0.9 );
+		for( int j = 0; j < segments.size(); ++j )
+		{
+			draw::line( segments.x1[j], segments.y1[j], segments.x2[j], segments.y2[j] );
+		}
+
+		for( int i = 0; i < NUM_CIRCLES; ++i )
+		{
+			if( touching[i] ) draw::setColor( 0.9, 0.2, 0.2 );
+			else draw::setColor( 0.5 );
+			draw::circle( circles.x[i], circles.y[i], circles.radius[i], 8 );
+		}
+
+		// Contact normals, as long as the overlap plus a bit to see them
+		draw::setColor( 0.2, 0.9, 0.2 );
+		for( const contact& c : contacts )
+		{
+			float len = c.depth + 4.0f;
+			draw::line( c.point.x, c.point.y, c.point.x + c.normal.x * len, c.point.y + c.normal.y * len );
+		}
+
+		draw::setColor( 1 );
+		sprintf( buf, "candidates: %d segment, %d circle",  (int)candidates.size(), (int)circleCandidates.size() );
+		draw::text( buf, 10, 10, textHeight );
+		sprintf( buf, "contacts: %d segment, %d circle",  segmentContacts, contacts.count - segmentContacts );
+		draw::text( buf, 10, 10 + textHeight, textHeight );
+
+		draw::present();
+	}
+
+	draw::shutdown();
+	return 0;
+}
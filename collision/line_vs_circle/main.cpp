@@ -2,6 +2,7 @@
 #include "../tjh_draw.h"
 
 #include "../tjh_math.h"
+#include "../tjh_collision.h"
 
 const int WIDTH = 1280;
 const int HEIGHT = 720;
@@ -25,27 +26,8 @@ float dist( float x1, float y1, float x2, float y2 )
 }
 
 bool isTouching( const circle& c, const line& l )
-{	
-	vec2 line( l.x2 - l.x1, l.y2 - l.y1 );
-	vec2 lineNormalized = line.normalized();
-
-	vec2 lineToCircle( c.pos.x - l.x1, c.pos.y - l.y1 );
-
-	float closestDist = lineToCircle.dot( lineNormalized );
-	vec2 closestPoint = vec2(l.x1, l.y1) + lineNormalized * closestDist;
-
-	draw::circle( closestPoint.x, closestPoint.y, 10 );
-
-	if( closestDist < 0 )
-	{
-		return c.pos.distance( {l.x1, l.y1} ) < c.radius;
-	}
-	else if( closestDist > line.length() )
-	{
-		return c.pos.distance( {l.x2, l.y2} ) < c.radius;
-	}
-
-	return closestPoint.distance( c.pos ) < c.radius;
+{
+	return circleTouchesSegment( c.pos.x, c.pos.y, c.radius, l.x1, l.y1, l.x2, l.y2 );
 }
 
 int main()
@@ -57,13 +39,17 @@ int main()
 
 	int mouseX, mouseY;
 
+	// Hold the left button and drag to sweep the circle from where you pressed
+	bool sweeping = false;
+	vec2 sweepStart;
+
 	circle c1{{0, 0}, 30};
 	line l1{200, 200, 500, 400};
 
 	bool done = false;
 	while( !done )
 	{
-		SDL_GetMouseState( &mouseX, &mouseY );
+		Uint32 buttons = SDL_GetMouseState( &mouseX, &mouseY );
 
 		SDL_Event event;
 		while( SDL_PollEvent( &event ) ) {
@@ -77,6 +63,30 @@ int main()
 		c1.pos.x = mouseX;
 		c1.pos.y = mouseY;
 
+		bool leftDown = ( buttons & SDL_BUTTON( SDL_BUTTON_LEFT ) ) != 0;
+		if( leftDown && !sweeping ) sweepStart = c1.pos;
+		sweeping = leftDown;
+
+		if( sweeping )
+		{
+			vec2 move = c1.pos - sweepStart;
+			draw::setColor( 0.4 );
+			draw::line( sweepStart.x, sweepStart.y, c1.pos.x, c1.pos.y );
+			draw::circle( sweepStart.x, sweepStart.y, c1.radius );
+
+			sweep_hit hit;
+			if( sweepCircleSegment( sweepStart.x, sweepStart.y, c1.radius, move.x, move.y, l1.x1, l1.y1, l1.x2, l1.y2, hit ) )
+			{
+				vec2 at = sweepStart + move * hit.toi;
+				draw::setColor( 0.2, 0.9, 0.2 );
+				draw::circle( at.x, at.y, c1.radius );
+				draw::line( hit.point.x, hit.point.y, hit.point.x + hit.normal.x * 20, hit.point.y + hit.normal.y * 20 );
+
+				sprintf( buf, "toi: %.3f", hit.toi );
+				draw::text( buf, at.x + c1.radius + 10, at.y, textHeight );
+			}
+		}
+
 		if( isTouching( c1, l1 ) )
 		{
 			draw::setColor( 0.9, 0.2, 0.2 );
@@ -103,6 +113,9 @@ int main()
 		draw::setColor( 0.9 );
 		l1.draw();
 
+		vec2 closestPoint = closestPointOnSegment( c1.pos.x, c1.pos.y, l1.x1, l1.y1, l1.x2, l1.y2 );
+		draw::circle( closestPoint.x, closestPoint.y, 10 );
+
 		draw::present();
 	}
 
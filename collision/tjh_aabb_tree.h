@@ -0,0 +1,464 @@
+#pragma once
+#ifndef TJH_AABB_TREE_H
+#define TJH_AABB_TREE_H
+
+// Dynamic AABB tree
+//
+// A binary tree of bounding boxes for things of any size that come, go and
+// move around. Each proxy (leaf) stores a "fat" box, a bit bigger than the
+// real one and stretched in the direction it's moving, so most frames a
+// moving object is still inside its fat box and the tree doesn't change.
+// When it does escape, the leaf is removed and inserted again.
+//
+// Insertion walks down from the root picking whichever side costs the least
+// extra perimeter (perimeter is the 2D stand-in for the surface area
+// heuristic). Then, on the way back up, each node tries swapping one child
+// with a grandchild on the other side and keeps whichever swap shrinks the
+// perimeter most, which keeps the tree tight as things move about.
+//
+// Queries: every proxy whose fat box overlaps a box, every proxy along a ray,
+// and the overlapping pairs involving proxies that moved since last time.
+//
+// Loosely follows Box2D's b2DynamicTree, see Erin Catto's "Dynamic BVH" talk.
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tjh_math.h"
+#include "tjh_collision.h"
+
+const int AABB_TREE_NULL = -1;
+
+struct aabb_tree_node
+{
+    aabb2 box;              // Fat box for leaves
+    int parent;             // Next free node when this node is free
+    int child1, child2;     // AABB_TREE_NULL for leaves
+    int height;             // 0 for leaves, -1 when free
+    int user;               // Whatever the proxy belongs to
+    bool moved;
+
+    inline bool isLeaf() const { return child1 == AABB_TREE_NULL; }
+};
+
+struct aabb_tree
+{
+    std::vector<aabb_tree_node> nodes;
+    int root = AABB_TREE_NULL;
+    int free_list = AABB_TREE_NULL;
+    int proxy_count = 0;
+
+    // How much bigger fat boxes are than the real ones, and how far ahead
+    // along the displacement they reach
+    float margin = 2.0f;
+    float displacement_scale = 4.0f;
+
+    // Proxies that were inserted or reinserted since the last treeMovedPairs()
+    std::vector<int> moved;
+};
+
+// Traversal stack, on the stack unless the tree gets unusually deep
+struct aabb_tree_stack
+{
+    int fixed[128];
+    std::vector<int> more;
+    int count = 0;
+
+    inline void push( int i ) { if( count < 128 ) fixed[count] = i; else more.push_back( i ); count++; }
+    inline int pop() { --count; if( count < 128 ) return fixed[count]; int i = more.back(); more.pop_back(); return i; }
+    inline bool empty() const { return count == 0; }
+};
+
+inline int treeAllocateNode( aabb_tree& t )
+{
+    if( t.free_list == AABB_TREE_NULL )
+    {
+        aabb_tree_node n;
+        n.parent = AABB_TREE_NULL;
+        n.height = -1;
+        t.nodes.push_back( n );
+        t.free_list = (int)t.nodes.size() - 1;
+    }
+
+    int id = t.free_list;
+    aabb_tree_node& n = t.nodes[id];
+    t.free_list = n.parent;
+
+    n.parent = n.child1 = n.child2 = AABB_TREE_NULL;
+    n.height = 0;
+    n.user = -1;
+    n.moved = false;
+    return id;
+}
+
+inline void treeFreeNode( aabb_tree& t, int id )
+{
+    t.nodes[id].parent = t.free_list;
+    t.nodes[id].height = -1;
+    t.free_list = id;
+}
+
+// Swaps a child of `a` with a grandchild under its other child, if that
+// makes the changed node's box smaller. a's own box doesn't change.
+inline void treeRotate( aabb_tree& t, int a )
+{
+    aabb_tree_node& A = t.nodes[a];
+    if( A.height < 2 )
+        return;
+
+    const int b = A.child1, c = A.child2;
+    aabb_tree_node& B = t.nodes[b];
+    aabb_tree_node& C = t.nodes[c];
+
+    // 0 is no rotation, then B<->F, B<->G, C<->D, C<->E
+    int best = 0;
+    float best_cost = 0.0f;
+
+    if( !C.isLeaf() )
+    {
+        const aabb2& F = t.nodes[C.child1].box;
+        const aabb2& G = t.nodes[C.child2].box;
+        float area = C.box.perimeter();
+
+        float cost_bf = B.box.merged( G ).perimeter() - area;
+        float cost_bg = B.box.merged( F ).perimeter() - area;
+        if( cost_bf < best_cost ) { best = 1; best_cost = cost_bf; }
+        if( cost_bg < best_cost ) { best = 2; best_cost = cost_bg; }
+    }
+
+    if( !B.isLeaf() )
+    {
+        const aabb2& D = t.nodes[B.child1].box;
+        const aabb2& E = t.nodes[B.child2].box;
+        float area = B.box.perimeter();
+
+        float cost_cd = C.box.merged( E ).perimeter() - area;
+        float cost_ce = C.box.merged( D ).perimeter() - area;
+        if( cost_cd < best_cost ) { best = 3; best_cost = cost_cd; }
+        if( cost_ce < best_cost ) { best = 4; best_cost = cost_ce; }
+    }
+
+    if( best == 0 )
+        return;
+
+    // `child` of `parent` at `slot` swaps places with `other`, the direct child of a
+    auto swap = [&]( int direct, int parent, int* slot, int other_in_parent )
+    {
+        int grandchild = *slot;
+        aabb_tree_node& P = t.nodes[parent];
+
+        if( A.child1 == direct ) A.child1 = grandchild; else A.child2 = grandchild;
+        t.nodes[grandchild].parent = a;
+
+        *slot = direct;
+        t.nodes[direct].parent = parent;
+
+        const aabb_tree_node& other = t.nodes[other_in_parent];
+        P.box = t.nodes[direct].box.merged( other.box );
+        P.height = 1 + std::max( t.nodes[direct].height, other.height );
+        A.height = 1 + std::max( t.nodes[A.child1].height, t.nodes[A.child2].height );
+    };
+
+    switch( best )
+    {
+        case 1: swap( b, c, &C.child1, C.child2 ); break;
+        case 2: swap( b, c, &C.child2, C.child1 ); break;
+        case 3: swap( c, b, &B.child1, B.child2 ); break;
+        case 4: swap( c, b, &B.child2, B.child1 ); break;
+    }
+}
+
+// Refits boxes and heights from `index` up to the root, rotating as it goes
+inline void treeRefitUp( aabb_tree& t, int index )
+{
+    while( index != AABB_TREE_NULL )
+    {
+        aabb_tree_node& n = t.nodes[index];
+        const aabb_tree_node& c1 = t.nodes[n.child1];
+        const aabb_tree_node& c2 = t.nodes[n.child2];
+
+        n.box = c1.box.merged( c2.box );
+        n.height = 1 + std::max( c1.height, c2.height );
+
+        treeRotate( t, index );
+        index = t.nodes[index].parent;
+    }
+}
+
+inline void treeInsertLeaf( aabb_tree& t, int leaf )
+{
+    if( t.root == AABB_TREE_NULL )
+    {
+        t.root = leaf;
+        t.nodes[leaf].parent = AABB_TREE_NULL;
+        return;
+    }
+
+    // Walk down to the cheapest sibling. Going into a child costs the growth
+    // of every node above it (the inheritance) plus the child's own growth.
+    const aabb2 box = t.nodes[leaf].box;
+    int index = t.root;
+    while( !t.nodes[index].isLeaf() )
+    {
+        const aabb_tree_node& n = t.nodes[index];
+
+        float area = n.box.perimeter();
+        float combined = n.box.merged( box ).perimeter();
+
+        // Making a new parent for this node and the leaf, here
+        float cost = 2.0f * combined;
+        float inheritance = 2.0f * ( combined - area );
+
+        auto descendCost = [&]( int child )
+        {
+            const aabb_tree_node& c = t.nodes[child];
+            float grown = c.box.merged( box ).perimeter();
+            return c.isLeaf() ? grown + inheritance : grown - c.box.perimeter() + inheritance;
+        };
+
+        float cost1 = descendCost( n.child1 );
+        float cost2 = descendCost( n.child2 );
+
+        if( cost < cost1 && cost < cost2 )
+            break;
+
+        index = cost1 < cost2 ? n.child1 : n.child2;
+    }
+
+    const int sibling = index;
+    const int old_parent = t.nodes[sibling].parent;
+    const int new_parent = treeAllocateNode( t );
+
+    aabb_tree_node& p = t.nodes[new_parent];
+    p.parent = old_parent;
+    p.child1 = sibling;
+    p.child2 = leaf;
+    p.box = box.merged( t.nodes[sibling].box );
+    p.height = t.nodes[sibling].height + 1;
+
+    if( old_parent != AABB_TREE_NULL )
+    {
+        aabb_tree_node& op = t.nodes[old_parent];
+        if( op.child1 == sibling ) op.child1 = new_parent; else op.child2 = new_parent;
+    }
+    else
+    {
+        t.root = new_parent;
+    }
+
+    t.nodes[sibling].parent = new_parent;
+    t.nodes[leaf].parent = new_parent;
+
+    treeRefitUp( t, old_parent );
+}
+
+inline void treeRemoveLeaf( aabb_tree& t, int leaf )
+{
+    if( leaf == t.root )
+    {
+        t.root = AABB_TREE_NULL;
+        return;
+    }
+
+    const int parent = t.nodes[leaf].parent;
+    const int grandparent = t.nodes[parent].parent;
+    const int sibling = t.nodes[parent].child1 == leaf ? t.nodes[parent].child2 : t.nodes[parent].child1;
+
+    if( grandparent != AABB_TREE_NULL )
+    {
+        aabb_tree_node& g = t.nodes[grandparent];
+        if( g.child1 == parent ) g.child1 = sibling; else g.child2 = sibling;
+        t.nodes[sibling].parent = grandparent;
+        treeFreeNode( t, parent );
+        treeRefitUp( t, grandparent );
+    }
+    else
+    {
+        t.root = sibling;
+        t.nodes[sibling].parent = AABB_TREE_NULL;
+        treeFreeNode( t, parent );
+    }
+}
+
+// Adds a proxy for `box`, returns its id
+inline int treeCreateProxy( aabb_tree& t, const aabb2& box, int user )
+{
+    int id = treeAllocateNode( t );
+    t.nodes[id].box = box.expanded( t.margin );
+    t.nodes[id].user = user;
+    t.nodes[id].moved = true;
+
+    treeInsertLeaf( t, id );
+    t.moved.push_back( id );
+    t.proxy_count++;
+    return id;
+}
+
+inline void treeDestroyProxy( aabb_tree& t, int proxy )
+{
+    // The node might be reused before the moved list is next looked at
+    if( t.nodes[proxy].moved )
+        std::replace( t.moved.begin(), t.moved.end(), proxy, AABB_TREE_NULL );
+
+    treeRemoveLeaf( t, proxy );
+    treeFreeNode( t, proxy );
+    t.proxy_count--;
+}
+
+// Updates a proxy to its new `box`, having moved `displacement` since last
+// time. Returns true if it left its fat box and was reinserted.
+inline bool treeMoveProxy( aabb_tree& t, int proxy, const aabb2& box, const vec2& displacement )
+{
+    aabb_tree_node& n = t.nodes[proxy];
+
+    // Still inside, unless the fat box is now far bigger than it needs to be
+    // (it was moving fast and has slowed down)
+    if( n.box.contains( box ) )
+    {
+        aabb2 huge = box.expanded( t.margin * 4.0f );
+        huge.min = huge.min + vec2( std::min( displacement.x, 0.0f ), std::min( displacement.y, 0.0f ) ) * ( t.displacement_scale * 4.0f );
+        huge.max = huge.max + vec2( std::max( displacement.x, 0.0f ), std::max( displacement.y, 0.0f ) ) * ( t.displacement_scale * 4.0f );
+        if( huge.contains( n.box ) )
+            return false;
+    }
+
+    treeRemoveLeaf( t, proxy );
+
+    aabb2 fat = box.expanded( t.margin );
+    vec2 d = displacement * t.displacement_scale;
+    if( d.x < 0.0f ) fat.min.x += d.x; else fat.max.x += d.x;
+    if( d.y < 0.0f ) fat.min.y += d.y; else fat.max.y += d.y;
+    t.nodes[proxy].box = fat;
+
+    treeInsertLeaf( t, proxy );
+
+    if( !t.nodes[proxy].moved )
+    {
+        t.nodes[proxy].moved = true;
+        t.moved.push_back( proxy );
+    }
+    return true;
+}
+
+// Calls f(proxy) for every proxy whose fat box overlaps `box`. Return false
+// from f to stop early.
+template<typename F>
+inline void treeQuery( const aabb_tree& t, const aabb2& box, F f )
+{
+    if( t.root == AABB_TREE_NULL )
+        return;
+
+    aabb_tree_stack stack;
+    stack.push( t.root );
+
+    while( !stack.empty() )
+    {
+        const aabb_tree_node& n = t.nodes[stack.pop()];
+        if( !n.box.overlaps( box ) )
+            continue;
+
+        if( n.isLeaf() )
+        {
+            if( !f( (int)( &n - t.nodes.data() ) ) )
+                return;
+        }
+        else
+        {
+            stack.push( n.child1 );
+            stack.push( n.child2 );
+        }
+    }
+}
+
+// Fraction along from->to where the ray enters `box`, or a value > max_fraction if it misses
+inline float rayEntersBox( const vec2& from, const vec2& inv_dir, const aabb2& box, float max_fraction )
+{
+    float tx1 = (box.min.x - from.x) * inv_dir.x, tx2 = (box.max.x - from.x) * inv_dir.x;
+    float ty1 = (box.min.y - from.y) * inv_dir.y, ty2 = (box.max.y - from.y) * inv_dir.y;
+
+    float tmin = std::max( std::min( tx1, tx2 ), std::min( ty1, ty2 ) );
+    float tmax = std::min( std::max( tx1, tx2 ), std::max( ty1, ty2 ) );
+
+    tmin = std::max( tmin, 0.0f );
+    return tmin <= tmax && tmin <= max_fraction ? tmin : max_fraction + 1.0f;
+}
+
+// Casts the ray from `from` to `to`, calling f(proxy, max_fraction) for each
+// proxy whose fat box it passes through before max_fraction. f returns the new
+// max_fraction: the fraction of its own hit to clip the ray there, the one it
+// was given to carry on, or 0 to stop.
+template<typename F>
+inline void treeRayCast( const aabb_tree& t, const vec2& from, const vec2& to, F f )
+{
+    if( t.root == AABB_TREE_NULL )
+        return;
+
+    vec2 dir = to - from;
+    // Infinities for axis aligned rays are fine, the slab test copes
+    vec2 inv_dir( 1.0f / dir.x, 1.0f / dir.y );
+    float max_fraction = 1.0f;
+
+    aabb_tree_stack stack;
+    stack.push( t.root );
+
+    while( !stack.empty() )
+    {
+        int id = stack.pop();
+        const aabb_tree_node& n = t.nodes[id];
+
+        if( rayEntersBox( from, inv_dir, n.box, max_fraction ) > max_fraction )
+            continue;
+
+        if( n.isLeaf() )
+        {
+            max_fraction = f( id, max_fraction );
+            if( max_fraction <= 0.0f )
+                return;
+        }
+        else
+        {
+            stack.push( n.child1 );
+            stack.push( n.child2 );
+        }
+    }
+}
+
+// Appends each pair of proxies with overlapping fat boxes where at least one
+// of them moved since the last call, as (user, user) with a < b, then clears
+// the moved flags. Pairs that were already overlapping and haven't moved
+// aren't repeated, keep those from earlier calls.
+inline void treeMovedPairs( aabb_tree& t, std::vector<collision_pair>& pairs )
+{
+    for( int proxy : t.moved )
+    {
+        if( proxy == AABB_TREE_NULL )
+            continue;   // Destroyed since it moved
+
+        const aabb_tree_node& n = t.nodes[proxy];
+        treeQuery( t, n.box, [&]( int other )
+        {
+            // Both moved, only report it from the lower id
+            if( other == proxy || ( t.nodes[other].moved && other < proxy ) )
+                return true;
+
+            int a = n.user, b = t.nodes[other].user;
+            pairs.push_back( { std::min( a, b ), std::max( a, b ) } );
+            return true;
+        } );
+    }
+
+    for( int proxy : t.moved )
+    {
+        if( proxy != AABB_TREE_NULL )
+            t.nodes[proxy].moved = false;
+    }
+    t.moved.clear();
+}
+
+inline int treeHeight( const aabb_tree& t )
+{
+    return t.root == AABB_TREE_NULL ? 0 : t.nodes[t.root].height;
+}
+
+#endif
@@ -0,0 +1,346 @@
+#pragma once
+#ifndef TJH_BROADPHASE_H
+#define TJH_BROADPHASE_H
+
+// 2D broadphase
+//
+// Cheap tests that throw away pairs that can't possibly touch, so the exact
+// tests in tjh_collision.h only run on pairs that might.
+//
+// segment_grid is for level geometry that doesn't move. It's built once, each
+// cell lists the segments that pass through it, then a circle only looks at
+// the cells its bounding box covers.
+//
+// sweep_and_prune is for circles that move every frame. They're kept sorted
+// by the left edge of their bounding box, then one sweep along x finds every
+// pair whose boxes overlap. Things only move a little each frame so the order
+// is nearly right already, and an insertion sort fixes it up in about O(n).
+//
+// Both output collision_pair lists: circle and segment for the grid, circle
+// and circle (a < b) for sweep and prune.
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tjh_collision.h"
+
+//
+// Static segments
+//
+
+struct segment_grid
+{
+    float cell_size = 64.0f;
+    float min_x = 0.0f, min_y = 0.0f;
+    int width = 0, height = 0;
+
+    // Cell c lists items[cell_start[c]] to items[cell_start[c+1]]
+    std::vector<int> cell_start;
+    std::vector<int> items;
+
+    // Last circle that saw each segment, so a segment in more than one of a
+    // circle's cells is only reported once
+    std::vector<int> seen;
+};
+
+// True unless the whole box is strictly on one side of the line through the segment
+inline bool lineCrossesBox( float x1, float y1, float x2, float y2, float bx0, float by0, float bx1, float by1 )
+{
+    float nx = y1 - y2, ny = x2 - x1;
+    float s0 = nx*(bx0 - x1) + ny*(by0 - y1);
+    float s1 = nx*(bx1 - x1) + ny*(by0 - y1);
+    float s2 = nx*(bx0 - x1) + ny*(by1 - y1);
+    float s3 = nx*(bx1 - x1) + ny*(by1 - y1);
+    return !( (s0 > 0 && s1 > 0 && s2 > 0 && s3 > 0) || (s0 < 0 && s1 < 0 && s2 < 0 && s3 < 0) );
+}
+
+// Calls f(cell) for each cell segment j passes through
+template<typename F>
+inline void forSegmentCells( const segment_grid& g, const segment_soa& s, int j, F f )
+{
+    float x0 = std::min( s.x1[j], s.x2[j] ), x1 = std::max( s.x1[j], s.x2[j] );
+    float y0 = std::min( s.y1[j], s.y2[j] ), y1 = std::max( s.y1[j], s.y2[j] );
+
+    int cx0 = (int)( (x0 - g.min_x) / g.cell_size ), cx1 = std::min( (int)( (x1 - g.min_x) / g.cell_size ), g.width - 1 );
+    int cy0 = (int)( (y0 - g.min_y) / g.cell_size ), cy1 = std::min( (int)( (y1 - g.min_y) / g.cell_size ), g.height - 1 );
+
+    for( int cy = cy0; cy <= cy1; ++cy )
+    {
+        for( int cx = cx0; cx <= cx1; ++cx )
+        {
+            float bx = g.min_x + cx * g.cell_size, by = g.min_y + cy * g.cell_size;
+            if( lineCrossesBox( s.x1[j], s.y1[j], s.x2[j], s.y2[j], bx, by, bx + g.cell_size, by + g.cell_size ) )
+                f( cy * g.width + cx );
+        }
+    }
+}
+
+inline void buildSegmentGrid( segment_grid& g, const segment_soa& s, float cell_size )
+{
+    g.cell_size = cell_size;
+
+    if( s.size() == 0 )
+    {
+        g.width = g.height = 0;
+        g.cell_start.assign( 1, 0 );
+        g.items.clear();
+        g.seen.clear();
+        return;
+    }
+
+    float max_x, max_y;
+    g.min_x = max_x = s.x1[0];
+    g.min_y = max_y = s.y1[0];
+    for( int j = 0; j < s.size(); ++j )
+    {
+        g.min_x = std::min( g.min_x, std::min( s.x1[j], s.x2[j] ) );
+        g.min_y = std::min( g.min_y, std::min( s.y1[j], s.y2[j] ) );
+        max_x = std::max( max_x, std::max( s.x1[j], s.x2[j] ) );
+        max_y = std::max( max_y, std::max( s.y1[j], s.y2[j] ) );
+    }
+
+    g.width = (int)( (max_x - g.min_x) / cell_size ) + 1;
+    g.height = (int)( (max_y - g.min_y) / cell_size ) + 1;
+
+    // Count, prefix sum, then fill, so it's two flat arrays rather than a
+    // vector per cell
+    g.cell_start.assign( g.width * g.height + 1, 0 );
+    for( int j = 0; j < s.size(); ++j )
+        forSegmentCells( g, s, j, [&]( int cell ) { g.cell_start[cell + 1]++; } );
+
+    for( int c = 0; c < g.width * g.height; ++c )
+        g.cell_start[c + 1] += g.cell_start[c];
+
+    std::vector<int> next( g.cell_start.begin(), g.cell_start.end() - 1 );
+    g.items.resize( g.cell_start.back() );
+    for( int j = 0; j < s.size(); ++j )
+        forSegmentCells( g, s, j, [&]( int cell ) { g.items[next[cell]++] = j; } );
+
+    g.seen.assign( s.size(), -1 );
+}
+
+// Appends (i, segment) for every segment in a cell that box i touches, box(i,
+// x0, y0, x1, y1) gives the box
+template<typename F>
+inline void gridBoxCandidates( segment_grid& g, int count, F box, std::vector<collision_pair>& pairs )
+{
+    if( g.width == 0 )
+        return;
+
+    const float inv = 1.0f / g.cell_size;
+
+    for( int i = 0; i < count; ++i )
+    {
+        float x0, y0, x1, y1;
+        box( i, x0, y0, x1, y1 );
+
+        float fx0 = (x0 - g.min_x) * inv, fx1 = (x1 - g.min_x) * inv;
+        float fy0 = (y0 - g.min_y) * inv, fy1 = (y1 - g.min_y) * inv;
+
+        // Completely outside the grid
+        if( fx1 < 0.0f || fy1 < 0.0f || fx0 >= g.width || fy0 >= g.height )
+            continue;
+
+        int cx0 = std::max( (int)fx0, 0 ), cx1 = std::min( (int)fx1, g.width - 1 );
+        int cy0 = std::max( (int)fy0, 0 ), cy1 = std::min( (int)fy1, g.height - 1 );
+
+        for( int cy = cy0; cy <= cy1; ++cy )
+        {
+            for( int cx = cx0; cx <= cx1; ++cx )
+            {
+                int cell = cy * g.width + cx;
+                for( int k = g.cell_start[cell]; k < g.cell_start[cell + 1]; ++k )
+                {
+                    int j = g.items[k];
+                    if( g.seen[j] == i )
+                        continue;
+
+                    g.seen[j] = i;
+                    pairs.push_back( { i, j } );
+                }
+            }
+        }
+    }
+
+    // Ready for the next call, whatever circles it gets
+    std::fill( g.seen.begin(), g.seen.end(), -1 );
+}
+
+// Appends every (circle, segment) pair where the segment is in a cell the
+// circle's bounding box touches
+inline void gridCandidates( segment_grid& g, const circle_soa& c, std::vector<collision_pair>& pairs )
+{
+    gridBoxCandidates( g, c.size(), [&]( int i, float& x0, float& y0, float& x1, float& y1 )
+    {
+        x0 = c.x[i] - c.radius[i]; x1 = c.x[i] + c.radius[i];
+        y0 = c.y[i] - c.radius[i]; y1 = c.y[i] + c.radius[i];
+    }, pairs );
+}
+
+// Same, for circles about to move by (move_x[i], move_y[i]), using the box
+// around the whole sweep
+inline void gridSweptCandidates( segment_grid& g, const circle_soa& c, const std::vector<float>& move_x, const std::vector<float>& move_y, std::vector<collision_pair>& pairs )
+{
+    gridBoxCandidates( g, c.size(), [&]( int i, float& x0, float& y0, float& x1, float& y1 )
+    {
+        x0 = c.x[i] + std::min( move_x[i], 0.0f ) - c.radius[i]; x1 = c.x[i] + std::max( move_x[i], 0.0f ) + c.radius[i];
+        y0 = c.y[i] + std::min( move_y[i], 0.0f ) - c.radius[i]; y1 = c.y[i] + std::max( move_y[i], 0.0f ) + c.radius[i];
+    }, pairs );
+}
+
+//
+// Moving circles
+//
+
+struct sweep_and_prune
+{
+    std::vector<int> order;     // Circle indices sorted by left edge
+    std::vector<float> left;    // Left edge of order[i], kept alongside so the sweep reads memory in order
+};
+
+// Re-sorts after the circles have moved. If circles were added or removed the
+// order is rebuilt from scratch.
+inline void sapUpdate( sweep_and_prune& sap, const circle_soa& c )
+{
+    const int n = c.size();
+
+    if( (int)sap.order.size() != n )
+    {
+        sap.order.resize( n );
+        for( int i = 0; i < n; ++i ) sap.order[i] = i;
+        std::sort( sap.order.begin(), sap.order.end(), [&]( int a, int b ) { return c.x[a] - c.radius[a] < c.x[b] - c.radius[b]; } );
+    }
+
+    sap.left.resize( n );
+    for( int i = 0; i < n; ++i )
+    {
+        int id = sap.order[i];
+        sap.left[i] = c.x[id] - c.radius[id];
+    }
+
+    // Insertion sort, almost nothing moves far between frames
+    for( int i = 1; i < n; ++i )
+    {
+        float key = sap.left[i];
+        int id = sap.order[i];
+
+        int j = i - 1;
+        while( j >= 0 && sap.left[j] > key )
+        {
+            sap.left[j + 1] = sap.left[j];
+            sap.order[j + 1] = sap.order[j];
+            j--;
+        }
+        sap.left[j + 1] = key;
+        sap.order[j + 1] = id;
+    }
+}
+
+// Appends every pair of circles whose bounding boxes overlap, needs sapUpdate()
+inline void sapPairs( const sweep_and_prune& sap, const circle_soa& c, std::vector<collision_pair>& pairs )
+{
+    const int n = (int)sap.order.size();
+
+    for( int i = 0; i < n; ++i )
+    {
+        int a = sap.order[i];
+        float right = c.x[a] + c.radius[a];
+        float top = c.y[a] - c.radius[a], bottom = c.y[a] + c.radius[a];
+
+        for( int k = i + 1; k < n && sap.left[k] <= right; ++k )
+        {
+            int b = sap.order[k];
+            if( c.y[b] + c.radius[b] < top || c.y[b] - c.radius[b] > bottom )
+                continue;
+
+            pairs.push_back( { std::min( a, b ), std::max( a, b ) } );
+        }
+    }
+}
+
+//
+// Narrowphase over broadphase output
+//
+
+// Keeps the (circle, segment) candidates that really touch, in the same order
+inline void circlesVsSegments( const circle_soa& c, const segment_soa& s, const std::vector<collision_pair>& candidates, std::vector<collision_pair>& hits )
+{
+    for( const collision_pair& p : candidates )
+    {
+        if( circleTouchesSegment( c.x[p.a], c.y[p.a], c.radius[p.a], s.x1[p.b], s.y1[p.b], s.x2[p.b], s.y2[p.b] ) )
+            hits.push_back( p );
+    }
+}
+
+// Writes a contact for each (circle, segment) candidate that really touches,
+// in the same order, until the buffer is full
+inline void circlesVsSegments( const circle_soa& c, const segment_soa& s, const std::vector<collision_pair>& candidates, contact_buffer& contacts )
+{
+    contact scratch;
+    for( const collision_pair& p : candidates )
+    {
+        // Write straight into the buffer, the scratch only takes the overflow
+        contact* out = contacts.count < contacts.capacity() ? &contacts.contacts[contacts.count] : &scratch;
+        if( !circleSegmentContact( c.x[p.a], c.y[p.a], c.radius[p.a], s.x1[p.b], s.y1[p.b], s.x2[p.b], s.y2[p.b], *out ) )
+            continue;
+
+        if( contacts.add() )
+        {
+            out->a = p.a;
+            out->b = p.b;
+        }
+    }
+}
+
+// Writes a contact for each (circle, circle) candidate that really touches,
+// in the same order, until the buffer is full
+inline void circlesVsCircles( const circle_soa& c, const std::vector<collision_pair>& candidates, contact_buffer& contacts )
+{
+    contact scratch;
+    for( const collision_pair& p : candidates )
+    {
+        contact* out = contacts.count < contacts.capacity() ? &contacts.contacts[contacts.count] : &scratch;
+        if( !circleCircleContact( c.x[p.a], c.y[p.a], c.radius[p.a], c.x[p.b], c.y[p.b], c.radius[p.b], *out ) )
+            continue;
+
+        if( contacts.add() )
+        {
+            out->a = p.a;
+            out->b = p.b;
+        }
+    }
+}
+
+// Sweeps the circles of the (circle, segment) candidates along (move_x,
+// move_y) and appends a sweep_hit for each one that touches, in the same
+// order. Use gridSweptCandidates() so fast circles find everything in their
+// path. A circle can hit several segments, the lowest toi is the one to stop at.
+inline void sweepCirclesVsSegments( const circle_soa& c, const std::vector<float>& move_x, const std::vector<float>& move_y, const segment_soa& s,
+                                    const std::vector<collision_pair>& candidates, std::vector<sweep_hit>& hits )
+{
+    sweep_hit hit;
+    for( const collision_pair& p : candidates )
+    {
+        if( sweepCircleSegment( c.x[p.a], c.y[p.a], c.radius[p.a], move_x[p.a], move_y[p.a], s.x1[p.b], s.y1[p.b], s.x2[p.b], s.y2[p.b], hit ) )
+        {
+            hit.a = p.a;
+            hit.b = p.b;
+            hits.push_back( hit );
+        }
+    }
+}
+
+// Keeps the (circle, circle) candidates that really touch, in the same order
+inline void circlesVsCircles( const circle_soa& c, const std::vector<collision_pair>& candidates, std::vector<collision_pair>& hits )
+{
+    for( const collision_pair& p : candidates )
+    {
+        float dx = c.x[p.b] - c.x[p.a], dy = c.y[p.b] - c.y[p.a];
+        float r = c.radius[p.a] + c.radius[p.b];
+        if( dx*dx + dy*dy < r*r )
+            hits.push_back( p );
+    }
+}
+
+#endif
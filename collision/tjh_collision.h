@@ -0,0 +1,467 @@
+#pragma once
+#ifndef TJH_COLLISION_H
+#define TJH_COLLISION_H
+
+// 2D collision tests
+//
+// Single tests take plain floats, batch tests take shapes stored as
+// struct-of-arrays (circle_soa, segment_soa) so 8 (AVX) or 4 (SSE) pairs are
+// tested at once. Nothing here draws or allocates except to grow an output
+// vector, and the overlap tests compare squared distances so there's no sqrt.
+
+#include <vector>
+#include <algorithm>
+
+#include "tjh_math.h"
+
+#if !defined(TJH_MATH_NO_SIMD) && (defined(__AVX__) || TJH_MATH_SSE)
+#include <immintrin.h>
+#endif
+
+struct circle_soa
+{
+    std::vector<float> x, y, radius;
+
+    inline int size() const { return (int)x.size(); }
+    inline void add( float cx, float cy, float r ) { x.push_back( cx ); y.push_back( cy ); radius.push_back( r ); }
+    inline void clear() { x.clear(); y.clear(); radius.clear(); }
+};
+
+struct segment_soa
+{
+    std::vector<float> x1, y1, x2, y2;
+
+    inline int size() const { return (int)x1.size(); }
+    inline void add( float ax, float ay, float bx, float by ) { x1.push_back( ax ); y1.push_back( ay ); x2.push_back( bx ); y2.push_back( by ); }
+    inline void clear() { x1.clear(); y1.clear(); x2.clear(); y2.clear(); }
+};
+
+// An overlapping pair, indices into the two inputs
+struct collision_pair
+{
+    int a, b;
+};
+
+//
+// Circle vs segment
+//
+// With d = B - A, f = P - A and t = dot(f, d), the closest point on the
+// segment is A when t <= 0, B when t >= dot(d, d), and otherwise the squared
+// distance is |f|^2 - t^2 / dot(d, d). Multiplying that case through by
+// dot(d, d) (which is positive there) avoids the divide too. Touching is
+// strictly closer than the radius.
+//
+
+inline bool circleTouchesSegment( float cx, float cy, float r, float x1, float y1, float x2, float y2 )
+{
+    float dx = x2 - x1, dy = y2 - y1;
+    float fx = cx - x1, fy = cy - y1;
+
+    float t  = fx*dx + fy*dy;
+    float dd = dx*dx + dy*dy;
+    float ff = fx*fx + fy*fy;
+    float rr = r*r;
+
+    if( t <= 0.0f ) return ff < rr;
+    if( t >= dd )
+    {
+        float gx = cx - x2, gy = cy - y2;
+        return gx*gx + gy*gy < rr;
+    }
+    return ff*dd - t*t < rr*dd;
+}
+
+// Closest point to (cx, cy) on the segment, for when you need the point too
+inline vec2 closestPointOnSegment( float cx, float cy, float x1, float y1, float x2, float y2 )
+{
+    float dx = x2 - x1, dy = y2 - y1;
+    float dd = dx*dx + dy*dy;
+    if( dd == 0.0f ) return vec2( x1, y1 );
+
+    float t = ( (cx - x1)*dx + (cy - y1)*dy ) / dd;
+    t = t < 0.0f ? 0.0f : ( t > 1.0f ? 1.0f : t );
+    return vec2( x1 + dx*t, y1 + dy*t );
+}
+
+//
+// Swept circle vs segment
+//
+// The tests above only look at where things are now, so a circle moving
+// further than its diameter in a frame can step right over a thin segment.
+// These sweep the circle along a displacement instead and find the first
+// moment it touches. The circle reaches the segment either on its flat side,
+// when the centre gets within r of the line, or on one of the ends, when the
+// centre gets within r of an endpoint, which is a ray vs circle test.
+//
+
+// The first contact of a sweep. toi is the fraction of the displacement
+// before touching, 0 if it was already touching. normal points from the
+// segment towards the circle.
+struct sweep_hit
+{
+    int a, b;
+    float toi;
+    vec2 point;
+    vec2 normal;
+};
+
+// Earliest t in [0, max_t] where p + m*t is within r of q, or -1
+inline float sweepPointVsPoint( float px, float py, float mx, float my, float r, float qx, float qy, float max_t )
+{
+    float fx = px - qx, fy = py - qy;
+    float a = mx*mx + my*my;
+    float b = fx*mx + fy*my;
+    float c = fx*fx + fy*fy - r*r;
+
+    if( b >= 0.0f || a == 0.0f )
+        return -1.0f;   // Moving away or not at all
+
+    float disc = b*b - a*c;
+    if( disc < 0.0f )
+        return -1.0f;
+
+    float t = ( -b - std::sqrt( disc ) ) / a;
+    return t <= max_t ? t : -1.0f;
+}
+
+// Sweeps the circle at (cx, cy) along (mx, my). Fills `hit` (apart from a
+// and b) and returns true if it touches the segment on the way.
+inline bool sweepCircleSegment( float cx, float cy, float r, float mx, float my, float x1, float y1, float x2, float y2, sweep_hit& hit )
+{
+    if( circleTouchesSegment( cx, cy, r, x1, y1, x2, y2 ) )
+    {
+        vec2 closest = closestPointOnSegment( cx, cy, x1, y1, x2, y2 );
+        vec2 away( cx - closest.x, cy - closest.y );
+        float len = away.length();
+
+        // Centre right on the segment, push out against the motion
+        if( len == 0.0f )
+        {
+            away = vec2( y1 - y2, x2 - x1 );
+            if( away.dot( vec2( mx, my ) ) > 0.0f ) away = away * -1.0f;
+            len = away.length();
+        }
+
+        hit.toi = 0.0f;
+        hit.point = closest;
+        hit.normal = len > 0.0f ? away / len : vec2( 0, 0 );
+        return true;
+    }
+
+    float best = 2.0f;
+    float dx = x2 - x1, dy = y2 - y1;
+    float dd = dx*dx + dy*dy;
+
+    // Flat side, only when moving towards the line. A circle already over the
+    // line past one end can only reach the segment by its ends.
+    if( dd > 0.0f )
+    {
+        float inv_len = 1.0f / std::sqrt( dd );
+        float nx = -dy * inv_len, ny = dx * inv_len;
+
+        float dist = (cx - x1)*nx + (cy - y1)*ny;
+        if( dist < 0.0f ) { nx = -nx; ny = -ny; dist = -dist; }
+
+        float closing = -( mx*nx + my*ny );
+        if( closing > 0.0f && dist >= r && dist - r <= closing )
+        {
+            float t = ( dist - r ) / closing;
+            float hx = cx + mx*t, hy = cy + my*t;
+            float along = (hx - x1)*dx + (hy - y1)*dy;
+            if( along >= 0.0f && along <= dd )
+            {
+                best = t;
+                hit.normal = vec2( nx, ny );
+                hit.point = vec2( hx - nx*r, hy - ny*r );
+            }
+        }
+    }
+
+    // The ends, anything hitting the flat side first has already been found
+    const float ends[2][2] = { { x1, y1 }, { x2, y2 } };
+    for( int e = 0; e < 2; ++e )
+    {
+        float t = sweepPointVsPoint( cx, cy, mx, my, r, ends[e][0], ends[e][1], std::min( best, 1.0f ) );
+        if( t >= 0.0f && t < best )
+        {
+            best = t;
+            hit.point = vec2( ends[e][0], ends[e][1] );
+            hit.normal = vec2( cx + mx*t - ends[e][0], cy + my*t - ends[e][1] ) / r;
+        }
+    }
+
+    if( best > 1.0f )
+        return false;
+
+    hit.toi = best;
+    return true;
+}
+
+//
+// Rays
+//
+// A ray goes from (ox, oy) to (ox + dx, oy + dy) and hits are the fraction t
+// along it, like a sweep of a point. A ray that starts inside a circle doesn't
+// hit it, so a ray from an object's centre ignores the object itself.
+//
+
+// Fraction along the ray where it crosses the segment, or -1
+inline float rayVsSegment( float ox, float oy, float dx, float dy, float x1, float y1, float x2, float y2 )
+{
+    // o + d*t = p1 + e*u, crossed with e for t and with d for u
+    float ex = x2 - x1, ey = y2 - y1;
+    float denom = dx*ey - dy*ex;
+    if( denom == 0.0f )
+        return -1.0f;   // Parallel
+
+    float wx = x1 - ox, wy = y1 - oy;
+    float t = ( wx*ey - wy*ex ) / denom;
+    float u = ( wx*dy - wy*dx ) / denom;
+    return t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f ? t : -1.0f;
+}
+
+// Fraction along the ray where it enters the circle, or -1
+inline float rayVsCircle( float ox, float oy, float dx, float dy, float cx, float cy, float r )
+{
+    float fx = ox - cx, fy = oy - cy;
+    if( fx*fx + fy*fy <= r*r )
+        return -1.0f;   // Starts inside
+
+    return sweepPointVsPoint( ox, oy, dx, dy, r, cx, cy, 1.0f );
+}
+
+//
+// Contacts
+//
+// Everything a response needs from an overlapping pair, worked out in the
+// same pass as the test so the solver doesn't have to do the geometry again.
+// Moving a by normal * depth (or each by half) pulls them apart.
+//
+
+struct contact
+{
+    int a, b;
+    vec2 point;     // On the surface of b
+    vec2 normal;    // Unit length, from b towards a
+    float depth;
+};
+
+// Fixed size, set up once with reserve(). Contacts that don't fit are
+// counted in `dropped` rather than growing it, so a frame with too many
+// contacts loses some instead of allocating.
+struct contact_buffer
+{
+    std::vector<contact> contacts;
+    int count = 0;
+    int dropped = 0;
+
+    inline void reserve( int capacity ) { contacts.resize( capacity ); count = dropped = 0; }
+    inline void clear() { count = dropped = 0; }
+    inline int capacity() const { return (int)contacts.size(); }
+
+    // Somewhere to write the next contact, or null when it's full
+    inline contact* add() { if( count < capacity() ) return &contacts[count++]; dropped++; return nullptr; }
+
+    inline const contact* begin() const { return contacts.data(); }
+    inline const contact* end() const { return contacts.data() + count; }
+};
+
+// Circle (a) vs segment (b), fills everything but the indices
+inline bool circleSegmentContact( float cx, float cy, float r, float x1, float y1, float x2, float y2, contact& out )
+{
+    float dx = x2 - x1, dy = y2 - y1;
+    float fx = cx - x1, fy = cy - y1;
+
+    float t  = fx*dx + fy*dy;
+    float dd = dx*dx + dy*dy;
+
+    float ff = fx*fx + fy*fy;
+    float rr = r*r;
+
+    // Same test as circleTouchesSegment(), the divide and sqrt only happen on a hit
+    float px, py, dist_sq;
+    if( t <= 0.0f )
+    {
+        if( ff >= rr ) return false;
+        px = x1; py = y1; dist_sq = ff;
+    }
+    else if( t >= dd )
+    {
+        float gx = cx - x2, gy = cy - y2;
+        dist_sq = gx*gx + gy*gy;
+        if( dist_sq >= rr ) return false;
+        px = x2; py = y2;
+    }
+    else
+    {
+        if( ff*dd - t*t >= rr*dd ) return false;
+        float u = t / dd;
+        px = x1 + dx*u; py = y1 + dy*u;
+        dist_sq = (cx - px)*(cx - px) + (cy - py)*(cy - py);
+    }
+
+    float nx = cx - px, ny = cy - py;
+    float dist = std::sqrt( dist_sq );
+    if( dist > 0.0f )
+    {
+        nx /= dist; ny /= dist;
+    }
+    else
+    {
+        // Centre right on the segment, any side will do, take the left
+        float len = std::sqrt( dd );
+        nx = len > 0.0f ? -dy / len : 0.0f;
+        ny = len > 0.0f ? dx / len : 1.0f;
+    }
+
+    out.point = vec2( px, py );
+    out.normal = vec2( nx, ny );
+    out.depth = r - dist;
+    return true;
+}
+
+// Circle (a) vs circle (b), fills everything but the indices
+inline bool circleCircleContact( float ax, float ay, float ar, float bx, float by, float br, contact& out )
+{
+    float nx = ax - bx, ny = ay - by;
+    float r = ar + br;
+    float dist_sq = nx*nx + ny*ny;
+    if( dist_sq >= r*r )
+        return false;
+
+    float dist = std::sqrt( dist_sq );
+    if( dist > 0.0f ) { nx /= dist; ny /= dist; }
+    else              { nx = 0.0f; ny = 1.0f; }
+
+    out.point = vec2( bx + nx*br, by + ny*br );
+    out.normal = vec2( nx, ny );
+    out.depth = r - dist;
+    return true;
+}
+
+// Segments [begin, end) against one circle, appends the hits
+inline void circleVsSegmentsScalar( const circle_soa& c, int i, const segment_soa& s, int begin, int end, std::vector<collision_pair>& hits )
+{
+    for( int j = begin; j < end; ++j )
+    {
+        if( circleTouchesSegment( c.x[i], c.y[i], c.radius[i], s.x1[j], s.y1[j], s.x2[j], s.y2[j] ) )
+            hits.push_back( { i, j } );
+    }
+}
+
+#if !defined(TJH_MATH_NO_SIMD) && defined(__AVX__)
+
+// One circle against 8 segments at a time, returns how many segments it did
+inline int circleVsSegmentsSimd( const circle_soa& c, int i, const segment_soa& s, std::vector<collision_pair>& hits )
+{
+    const int count = s.size();
+
+    const __m256 cx = _mm256_set1_ps( c.x[i] );
+    const __m256 cy = _mm256_set1_ps( c.y[i] );
+    const __m256 rr = _mm256_set1_ps( c.radius[i] * c.radius[i] );
+    const __m256 zero = _mm256_setzero_ps();
+
+    int j = 0;
+    for( ; j + 8 <= count; j += 8 )
+    {
+        __m256 x1 = _mm256_loadu_ps( &s.x1[j] ), y1 = _mm256_loadu_ps( &s.y1[j] );
+        __m256 x2 = _mm256_loadu_ps( &s.x2[j] ), y2 = _mm256_loadu_ps( &s.y2[j] );
+
+        __m256 dx = _mm256_sub_ps( x2, x1 ), dy = _mm256_sub_ps( y2, y1 );
+        __m256 fx = _mm256_sub_ps( cx, x1 ), fy = _mm256_sub_ps( cy, y1 );
+        __m256 gx = _mm256_sub_ps( cx, x2 ), gy = _mm256_sub_ps( cy, y2 );
+
+        __m256 t  = _mm256_add_ps( _mm256_mul_ps( fx, dx ), _mm256_mul_ps( fy, dy ) );
+        __m256 dd = _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) );
+        __m256 ff = _mm256_add_ps( _mm256_mul_ps( fx, fx ), _mm256_mul_ps( fy, fy ) );
+        __m256 gg = _mm256_add_ps( _mm256_mul_ps( gx, gx ), _mm256_mul_ps( gy, gy ) );
+
+        // All three cases, then pick
+        __m256 hit_a   = _mm256_cmp_ps( ff, rr, _CMP_LT_OQ );
+        __m256 hit_b   = _mm256_cmp_ps( gg, rr, _CMP_LT_OQ );
+        __m256 hit_mid = _mm256_cmp_ps( _mm256_sub_ps( _mm256_mul_ps( ff, dd ), _mm256_mul_ps( t, t ) ), _mm256_mul_ps( rr, dd ), _CMP_LT_OQ );
+
+        __m256 before = _mm256_cmp_ps( t, zero, _CMP_LE_OQ );
+        __m256 after  = _mm256_cmp_ps( t, dd, _CMP_GE_OQ );
+
+        __m256 hit = _mm256_blendv_ps( hit_mid, hit_b, after );
+        hit = _mm256_blendv_ps( hit, hit_a, before );
+
+        int mask = _mm256_movemask_ps( hit );
+        while( mask )
+        {
+            int bit = tjh_ctz( mask );
+            hits.push_back( { i, j + bit } );
+            mask &= mask - 1;
+        }
+    }
+    return j;
+}
+
+#elif TJH_MATH_SSE
+
+// One circle against 4 segments at a time, returns how many segments it did
+inline int circleVsSegmentsSimd( const circle_soa& c, int i, const segment_soa& s, std::vector<collision_pair>& hits )
+{
+    const int count = s.size();
+
+    const __m128 cx = _mm_set1_ps( c.x[i] );
+    const __m128 cy = _mm_set1_ps( c.y[i] );
+    const __m128 rr = _mm_set1_ps( c.radius[i] * c.radius[i] );
+    const __m128 zero = _mm_setzero_ps();
+
+    int j = 0;
+    for( ; j + 4 <= count; j += 4 )
+    {
+        __m128 x1 = _mm_loadu_ps( &s.x1[j] ), y1 = _mm_loadu_ps( &s.y1[j] );
+        __m128 x2 = _mm_loadu_ps( &s.x2[j] ), y2 = _mm_loadu_ps( &s.y2[j] );
+
+        __m128 dx = _mm_sub_ps( x2, x1 ), dy = _mm_sub_ps( y2, y1 );
+        __m128 fx = _mm_sub_ps( cx, x1 ), fy = _mm_sub_ps( cy, y1 );
+        __m128 gx = _mm_sub_ps( cx, x2 ), gy = _mm_sub_ps( cy, y2 );
+
+        __m128 t  = _mm_add_ps( _mm_mul_ps( fx, dx ), _mm_mul_ps( fy, dy ) );
+        __m128 dd = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+        __m128 ff = _mm_add_ps( _mm_mul_ps( fx, fx ), _mm_mul_ps( fy, fy ) );
+        __m128 gg = _mm_add_ps( _mm_mul_ps( gx, gx ), _mm_mul_ps( gy, gy ) );
+
+        __m128 hit_a   = _mm_cmplt_ps( ff, rr );
+        __m128 hit_b   = _mm_cmplt_ps( gg, rr );
+        __m128 hit_mid = _mm_cmplt_ps( _mm_sub_ps( _mm_mul_ps( ff, dd ), _mm_mul_ps( t, t ) ), _mm_mul_ps( rr, dd ) );
+
+        __m128 before = _mm_cmple_ps( t, zero );
+        __m128 after  = _mm_andnot_ps( before, _mm_cmpge_ps( t, dd ) );
+        __m128 middle = _mm_andnot_ps( _mm_or_ps( before, after ), _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) );
+
+        __m128 hit = _mm_or_ps( _mm_and_ps( before, hit_a ),
+                     _mm_or_ps( _mm_and_ps( after, hit_b ), _mm_and_ps( middle, hit_mid ) ) );
+
+        int mask = _mm_movemask_ps( hit );
+        while( mask )
+        {
+            int bit = tjh_ctz( mask );
+            hits.push_back( { i, j + bit } );
+            mask &= mask - 1;
+        }
+    }
+    return j;
+}
+
+#else
+
+inline int circleVsSegmentsSimd( const circle_soa&, int, const segment_soa&, std::vector<collision_pair>& ) { return 0; }
+
+#endif
+
+// Tests every circle against every segment, appends the touching pairs to
+// `hits` in order of circle then segment. a is the circle, b the segment.
+inline void circlesVsSegments( const circle_soa& circles, const segment_soa& segments, std::vector<collision_pair>& hits )
+{
+    for( int i = 0; i < circles.size(); ++i )
+    {
+        int done = circleVsSegmentsSimd( circles, i, segments, hits );
+        circleVsSegmentsScalar( circles, i, segments, done, segments.size(), hits );
+    }
+}
+
+#endif
@@ -0,0 +1,736 @@
+#pragma once
+#ifndef TJH_COLLISION3D_H
+#define TJH_COLLISION3D_H
+
+// 3D collision tests
+//
+// The simple shapes each get their own test: sphere, axis aligned box,
+// oriented box (separating axis test) and triangle. Anything else that's
+// convex goes through GJK, and EPA when GJK finds they overlap.
+//
+// Every test fills a contact3 the same way as the 2D contacts: the normal is
+// unit length and points from b towards a, so moving a by normal * depth
+// pulls them apart. The point is on the surface of b.
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "tjh_math.h"
+
+struct contact3
+{
+    vec3 point;
+    vec3 normal;
+    float depth;
+};
+
+struct sphere
+{
+    vec3 center;
+    float radius;
+};
+
+// A box turned any way. The axes are unit length and at right angles.
+struct obb
+{
+    vec3 center;
+    vec3 axis[3];
+    vec3 half;      // Half the size along each axis
+};
+
+struct triangle
+{
+    vec3 a, b, c;
+};
+
+// The points of a convex shape, kept as struct-of-arrays so the support
+// function is one pass over three flat arrays
+struct convex_hull
+{
+    std::vector<float> x, y, z;
+
+    inline int size() const { return (int)x.size(); }
+    inline void add( const vec3& p ) { x.push_back( p.x ); y.push_back( p.y ); z.push_back( p.z ); }
+    inline void clear() { x.clear(); y.clear(); z.clear(); }
+    inline vec3 point( int i ) const { return vec3( x[i], y[i], z[i] ); }
+};
+
+//
+// Sphere and box tests
+//
+
+inline bool sphereVsSphere( const sphere& a, const sphere& b, contact3& out )
+{
+    vec3 d = a.center - b.center;
+    float r = a.radius + b.radius;
+    float dist_sq = d.lengthSquared();
+    if( dist_sq >= r*r )
+        return false;
+
+    float dist = std::sqrt( dist_sq );
+    out.normal = dist > 0.0f ? d / dist : vec3( 0, 1, 0 );
+    out.point = b.center + out.normal * b.radius;
+    out.depth = r - dist;
+    return true;
+}
+
+inline bool sphereVsAabb( const sphere& a, const aabb3& b, contact3& out )
+{
+    vec3 closest = b.closestPoint( a.center );
+    vec3 d = a.center - closest;
+    float dist_sq = d.lengthSquared();
+    if( dist_sq >= a.radius * a.radius )
+        return false;
+
+    if( dist_sq > 0.0f )
+    {
+        float dist = std::sqrt( dist_sq );
+        out.normal = d / dist;
+        out.point = closest;
+        out.depth = a.radius - dist;
+        return true;
+    }
+
+    // Centre inside the box, out through the nearest face
+    float best = FLT_MAX;
+    for( int i = 0; i < 3; ++i )
+    {
+        float to_min = a.center.e[i] - b.min.e[i];
+        float to_max = b.max.e[i] - a.center.e[i];
+        if( to_min < best ) { best = to_min; out.normal = vec3(); out.normal.e[i] = -1.0f; out.point = a.center; out.point.e[i] = b.min.e[i]; }
+        if( to_max < best ) { best = to_max; out.normal = vec3(); out.normal.e[i] = 1.0f; out.point = a.center; out.point.e[i] = b.max.e[i]; }
+    }
+    out.depth = a.radius + best;
+    return true;
+}
+
+// Pushes out along the axis they overlap least on
+inline bool aabbVsAabb( const aabb3& a, const aabb3& b, contact3& out )
+{
+    // How far a has to go each way to get clear, which is more than the
+    // overlap when one box is inside the other on that axis
+    float best = FLT_MAX;
+    int axis = 0;
+    float sign = 1.0f;
+    for( int i = 0; i < 3; ++i )
+    {
+        float up = b.max.e[i] - a.min.e[i];
+        float down = a.max.e[i] - b.min.e[i];
+        if( up <= 0.0f || down <= 0.0f )
+            return false;
+        if( up < best ) { best = up; axis = i; sign = 1.0f; }
+        if( down < best ) { best = down; axis = i; sign = -1.0f; }
+    }
+
+    out.normal = vec3();
+    out.normal.e[axis] = sign;
+    out.depth = best;
+
+    // Middle of the overlap, on b's face
+    out.point = aabb3( vec3( std::max( a.min.x, b.min.x ), std::max( a.min.y, b.min.y ), std::max( a.min.z, b.min.z ) ),
+                       vec3( std::min( a.max.x, b.max.x ), std::min( a.max.y, b.max.y ), std::min( a.max.z, b.max.z ) ) ).center();
+    out.point.e[axis] = out.normal.e[axis] > 0.0f ? b.max.e[axis] : b.min.e[axis];
+    return true;
+}
+
+//
+// Oriented boxes
+//
+// Two convex shapes are apart if there's an axis they don't overlap on. For
+// boxes it's enough to try the 3 face normals of each and the 9 cross products
+// of an edge from each, 15 in all. If none separate them, the one with the
+// least overlap is the way out. The point is just the corner of b deepest
+// into a; a full face to face manifold would need clipping.
+//
+
+// How far the box reaches along `axis` from its centre
+inline float obbProject( const obb& b, const vec3& axis )
+{
+    return b.half.x * std::fabs( axis.dot( b.axis[0] ) ) + b.half.y * std::fabs( axis.dot( b.axis[1] ) ) + b.half.z * std::fabs( axis.dot( b.axis[2] ) );
+}
+
+inline bool obbVsObb( const obb& a, const obb& b, contact3& out )
+{
+    const vec3 t = a.center - b.center;
+
+    float best = FLT_MAX;
+    vec3 best_axis;
+
+    auto tryAxis = [&]( vec3 axis )
+    {
+        float len_sq = axis.lengthSquared();
+        if( len_sq < 1e-8f )
+            return true;    // Edges are parallel, the face axes cover it
+
+        float inv_len = 1.0f / std::sqrt( len_sq );
+        float dist = t.dot( axis );
+        float overlap = ( obbProject( a, axis ) + obbProject( b, axis ) - std::fabs( dist ) ) * inv_len;
+        if( overlap < 0.0f )
+            return false;
+
+        // A little bias towards face axes, so nearly parallel edges don't win
+        // on rounding and make a poor normal
+        if( overlap < best * 0.999f )
+        {
+            best = overlap;
+            best_axis = axis * ( dist < 0.0f ? -inv_len : inv_len );
+        }
+        return true;
+    };
+
+    for( int i = 0; i < 3; ++i )
+        if( !tryAxis( a.axis[i] ) ) return false;
+    for( int i = 0; i < 3; ++i )
+        if( !tryAxis( b.axis[i] ) ) return false;
+    for( int i = 0; i < 3; ++i )
+        for( int j = 0; j < 3; ++j )
+            if( !tryAxis( a.axis[i].cross( b.axis[j] ) ) ) return false;
+
+    out.normal = best_axis;
+    out.depth = best;
+
+    out.point = b.center;
+    for( int i = 0; i < 3; ++i )
+        out.point += b.axis[i] * ( best_axis.dot( b.axis[i] ) > 0.0f ? b.half.e[i] : -b.half.e[i] );
+    return true;
+}
+
+//
+// Sphere vs triangle
+//
+
+// Closest point to p on the triangle, from Real-Time Collision Detection 5.1.5.
+// Works out which region p is in (a corner, an edge or the face) with dot
+// products, so there's no divide until it knows the answer.
+inline vec3 closestPointOnTriangle( const vec3& p, const triangle& t )
+{
+    vec3 ab = t.b - t.a, ac = t.c - t.a, ap = p - t.a;
+    float d1 = ab.dot( ap ), d2 = ac.dot( ap );
+    if( d1 <= 0.0f && d2 <= 0.0f ) return t.a;
+
+    vec3 bp = p - t.b;
+    float d3 = ab.dot( bp ), d4 = ac.dot( bp );
+    if( d3 >= 0.0f && d4 <= d3 ) return t.b;
+
+    float vc = d1*d4 - d3*d2;
+    if( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f ) return t.a + ab * ( d1 / (d1 - d3) );
+
+    vec3 cp = p - t.c;
+    float d5 = ab.dot( cp ), d6 = ac.dot( cp );
+    if( d6 >= 0.0f && d5 <= d6 ) return t.c;
+
+    float vb = d5*d2 - d1*d6;
+    if( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f ) return t.a + ac * ( d2 / (d2 - d6) );
+
+    float va = d3*d6 - d5*d4;
+    if( va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f ) return t.b + (t.c - t.b) * ( (d4 - d3) / ((d4 - d3) + (d5 - d6)) );
+
+    float denom = 1.0f / (va + vb + vc);
+    return t.a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+inline bool sphereVsTriangle( const sphere& a, const triangle& b, contact3& out )
+{
+    vec3 closest = closestPointOnTriangle( a.center, b );
+    vec3 d = a.center - closest;
+    float dist_sq = d.lengthSquared();
+    if( dist_sq >= a.radius * a.radius )
+        return false;
+
+    float dist = std::sqrt( dist_sq );
+    if( dist > 0.0f )
+    {
+        out.normal = d / dist;
+    }
+    else
+    {
+        // Centre right in the triangle, either side will do
+        out.normal = (b.b - b.a).cross( b.c - b.a ).normal();
+    }
+    out.point = closest;
+    out.depth = a.radius - dist;
+    return true;
+}
+
+//
+// Support functions
+//
+// The point of a shape furthest along a direction. That's all GJK and EPA
+// need to know about a shape, so anything convex with one of these works.
+//
+
+inline vec3 support( const sphere& s, const vec3& d )
+{
+    return s.center + d.normal() * s.radius;
+}
+
+inline vec3 support( const aabb3& b, const vec3& d )
+{
+    return vec3( d.x > 0.0f ? b.max.x : b.min.x, d.y > 0.0f ? b.max.y : b.min.y, d.z > 0.0f ? b.max.z : b.min.z );
+}
+
+inline vec3 support( const obb& b, const vec3& d )
+{
+    vec3 p = b.center;
+    for( int i = 0; i < 3; ++i )
+        p += b.axis[i] * ( d.dot( b.axis[i] ) > 0.0f ? b.half.e[i] : -b.half.e[i] );
+    return p;
+}
+
+inline vec3 support( const triangle& t, const vec3& d )
+{
+    float da = d.dot( t.a ), db = d.dot( t.b ), dc = d.dot( t.c );
+    if( da >= db && da >= dc ) return t.a;
+    return db >= dc ? t.b : t.c;
+}
+
+inline vec3 support( const convex_hull& h, const vec3& d )
+{
+    const int n = h.size();
+    const float* x = h.x.data();
+    const float* y = h.y.data();
+    const float* z = h.z.data();
+
+    int best = 0;
+    float best_dot = -FLT_MAX;
+    for( int i = 0; i < n; ++i )
+    {
+        float dot = x[i]*d.x + y[i]*d.y + z[i]*d.z;
+        if( dot > best_dot ) { best_dot = dot; best = i; }
+    }
+    return h.point( best );
+}
+
+//
+// GJK
+//
+// Looks for the origin in the Minkowski difference A - B, which is there if
+// and only if A and B overlap. Each step adds the support point in the
+// direction of the origin to a simplex (a point, line, triangle or
+// tetrahedron), then throws away whatever part of it isn't nearest the
+// origin. If a new support point doesn't get past the origin then that
+// direction separates the shapes.
+//
+// Things don't move much from one frame to the next, so the direction that
+// separated them last time usually still does. Keep a gjk_cache per pair and
+// separated pairs are usually found with one support call on each shape.
+//
+
+struct gjk_cache
+{
+    vec3 axis;      // Last separating direction, zero to start fresh
+};
+
+// A point of the Minkowski difference, with the points of A and B it came from
+struct gjk_vertex
+{
+    vec3 w, a, b;
+};
+
+struct gjk_simplex
+{
+    gjk_vertex v[4];    // Newest first
+    int count = 0;
+
+    inline void push( const gjk_vertex& p ) { for( int i = count; i > 0; --i ) v[i] = v[i-1]; v[0] = p; count++; }
+};
+
+template<typename A, typename B>
+inline gjk_vertex gjkSupport( const A& a, const B& b, const vec3& d )
+{
+    gjk_vertex p;
+    p.a = support( a, d );
+    p.b = support( b, d * -1.0f );
+    p.w = p.a - p.b;
+    return p;
+}
+
+inline bool sameDirection( const vec3& a, const vec3& b ) { return a.dot( b ) > 0.0f; }
+
+// Keeps the part of the simplex nearest the origin and points d at the origin
+// from it. Returns true once a tetrahedron holds the origin.
+inline bool gjkLine( gjk_simplex& s, vec3& d )
+{
+    vec3 a = s.v[0].w, b = s.v[1].w;
+    vec3 ab = b - a, ao = a * -1.0f;
+
+    if( sameDirection( ab, ao ) )
+    {
+        d = ab.cross( ao ).cross( ab );
+    }
+    else
+    {
+        s.count = 1;
+        d = ao;
+    }
+    return false;
+}
+
+inline bool gjkTriangle( gjk_simplex& s, vec3& d )
+{
+    vec3 a = s.v[0].w, b = s.v[1].w, c = s.v[2].w;
+    vec3 ab = b - a, ac = c - a, ao = a * -1.0f;
+    vec3 abc = ab.cross( ac );
+
+    if( sameDirection( abc.cross( ac ), ao ) )
+    {
+        if( sameDirection( ac, ao ) )
+        {
+            s.v[1] = s.v[2];
+            s.count = 2;
+            d = ac.cross( ao ).cross( ac );
+            return false;
+        }
+
+        s.count = 2;
+        return gjkLine( s, d );
+    }
+
+    if( sameDirection( ab.cross( abc ), ao ) )
+    {
+        s.count = 2;
+        return gjkLine( s, d );
+    }
+
+    if( sameDirection( abc, ao ) )
+    {
+        d = abc;
+    }
+    else
+    {
+        std::swap( s.v[1], s.v[2] );
+        d = abc * -1.0f;
+    }
+    return false;
+}
+
+inline bool gjkTetrahedron( gjk_simplex& s, vec3& d )
+{
+    vec3 a = s.v[0].w, b = s.v[1].w, c = s.v[2].w, dd = s.v[3].w;
+    vec3 ab = b - a, ac = c - a, ad = dd - a, ao = a * -1.0f;
+
+    vec3 abc = ab.cross( ac );
+    vec3 acd = ac.cross( ad );
+    vec3 adb = ad.cross( ab );
+
+    if( sameDirection( abc, ao ) )
+    {
+        s.count = 3;
+        return gjkTriangle( s, d );
+    }
+    if( sameDirection( acd, ao ) )
+    {
+        s.v[1] = s.v[2]; s.v[2] = s.v[3];
+        s.count = 3;
+        return gjkTriangle( s, d );
+    }
+    if( sameDirection( adb, ao ) )
+    {
+        s.v[2] = s.v[1]; s.v[1] = s.v[3];
+        s.count = 3;
+        return gjkTriangle( s, d );
+    }
+    return true;
+}
+
+// The origin is on a point, line or triangle simplex, which could be anywhere
+// inside A - B, so there's no telling the depth from it. Adds support points
+// off to the side until it's a tetrahedron for epa(). False if A - B is flat
+// that way too, then the origin really is on its surface and they only touch.
+template<typename A, typename B>
+inline bool gjkFillSimplex( const A& a, const B& b, gjk_simplex& s )
+{
+    const float eps = 1e-5f;
+
+    if( s.count == 1 )
+    {
+        const vec3 axes[6] = { vec3( 1, 0, 0 ), vec3( -1, 0, 0 ), vec3( 0, 1, 0 ),
+                               vec3( 0, -1, 0 ), vec3( 0, 0, 1 ), vec3( 0, 0, -1 ) };
+        for( int i = 0; i < 6 && s.count == 1; ++i )
+        {
+            gjk_vertex p = gjkSupport( a, b, axes[i] );
+            if( ( p.w - s.v[0].w ).length() > eps )
+                s.push( p );
+        }
+        if( s.count == 1 )
+            return false;
+    }
+
+    if( s.count == 2 )
+    {
+        vec3 ab = s.v[1].w - s.v[0].w;
+        float len = ab.length();
+        if( len < eps )
+            return false;
+        ab = ab / len;
+
+        // Two directions across the line, from whichever axis is least along it
+        float x = std::fabs( ab.x ), y = std::fabs( ab.y ), z = std::fabs( ab.z );
+        vec3 axis = x <= y && x <= z ? vec3( 1, 0, 0 ) : ( y <= z ? vec3( 0, 1, 0 ) : vec3( 0, 0, 1 ) );
+        vec3 u = ab.cross( axis ).normal();
+        vec3 w = ab.cross( u );
+
+        // Round the line in 60 degree steps
+        const float c[6] = { 1.0f, 0.5f, -0.5f, -1.0f, -0.5f, 0.5f };
+        const float sn[6] = { 0.0f, 0.8660254f, 0.8660254f, 0.0f, -0.8660254f, -0.8660254f };
+        for( int i = 0; i < 6 && s.count == 2; ++i )
+        {
+            gjk_vertex p = gjkSupport( a, b, u * c[i] + w * sn[i] );
+            if( ( p.w - s.v[0].w ).cross( ab ).length() > eps )
+                s.push( p );
+        }
+        if( s.count == 2 )
+            return false;
+    }
+
+    if( s.count == 3 )
+    {
+        vec3 n = ( s.v[1].w - s.v[0].w ).cross( s.v[2].w - s.v[0].w );
+        float len = n.length();
+        if( len < eps * eps )
+            return false;
+        n = n / len;
+
+        gjk_vertex p = gjkSupport( a, b, n );
+        if( ( p.w - s.v[0].w ).dot( n ) <= eps )
+        {
+            p = gjkSupport( a, b, n * -1.0f );
+            if( ( p.w - s.v[0].w ).dot( n ) >= -eps )
+                return false;
+        }
+        s.push( p );
+    }
+    return true;
+}
+
+// True if a and b overlap. On a hit `s` holds a tetrahedron around the
+// origin (for epa()), unless they only just touch.
+template<typename A, typename B>
+inline bool gjk( const A& a, const B& b, gjk_cache& cache, gjk_simplex& s )
+{
+    vec3 d = cache.axis.lengthSquared() > 0.0f ? cache.axis : vec3( 1, 0, 0 );
+
+    s.count = 0;
+    gjk_vertex p = gjkSupport( a, b, d );
+    if( p.w.dot( d ) < 0.0f )
+        return false;   // The cached axis still works
+
+    s.push( p );
+    d = p.w * -1.0f;
+
+    for( int iteration = 0; iteration < 64; ++iteration )
+    {
+        // The origin is on the simplex, somewhere in A - B
+        if( d.lengthSquared() < 1e-12f )
+        {
+            gjkFillSimplex( a, b, s );
+            return true;
+        }
+
+        p = gjkSupport( a, b, d );
+        if( p.w.dot( d ) < 0.0f )
+        {
+            cache.axis = d;
+            return false;
+        }
+
+        // No further along d than the simplex already was, so it's never
+        // going to get round the origin. They're within rounding of touching,
+        // without this it can go back and forth between the same points.
+        if( ( p.w - s.v[0].w ).dot( d ) <= 1e-6f * d.length() )
+        {
+            cache.axis = d;
+            return false;
+        }
+
+        s.push( p );
+
+        bool inside = false;
+        switch( s.count )
+        {
+            case 2: inside = gjkLine( s, d ); break;
+            case 3: inside = gjkTriangle( s, d ); break;
+            case 4: inside = gjkTetrahedron( s, d ); break;
+        }
+        if( inside )
+            return true;
+    }
+
+    // Not converging, it's right on the edge
+    return false;
+}
+
+//
+// EPA
+//
+// Starting from GJK's tetrahedron, grows a polytope out towards the surface
+// of A - B. The face nearest the origin gives the normal and depth. Each step
+// adds the support point beyond the nearest face, removes the faces that can
+// see it and fills the hole. It stops when the new point is no further out
+// than the face, so for round shapes the depth is only as good as `tolerance`.
+// Round shapes sunk almost centre to centre are the worst case, every way
+// out is nearly as short, and it can run out of vertices a little short of
+// the answer. The sphere tests above are exact, use those when you can.
+//
+// Everything's in fixed arrays on the stack, nothing allocates.
+//
+
+const int EPA_MAX_VERTICES = 128;
+const int EPA_MAX_FACES = 256;
+
+struct epa_face
+{
+    int i[3];
+    vec3 normal;
+    float dist;
+};
+
+// The normal follows the winding, a b c anticlockwise seen from outside
+inline bool epaMakeFace( const gjk_vertex* v, int a, int b, int c, epa_face& f )
+{
+    vec3 n = ( v[b].w - v[a].w ).cross( v[c].w - v[a].w );
+    float len = n.length();
+    if( len < 1e-12f )
+        return false;
+
+    f.i[0] = a; f.i[1] = b; f.i[2] = c;
+    f.normal = n / len;
+    f.dist = f.normal.dot( v[a].w );
+    return true;
+}
+
+// Contact for shapes gjk() found overlapping, `s` is what it left
+template<typename A, typename B>
+inline bool epa( const A& a, const B& b, const gjk_simplex& s, contact3& out, float tolerance = 1e-4f )
+{
+    if( s.count < 4 )
+    {
+        // Only touching, no depth to find
+        out.normal = vec3( 0, 1, 0 );
+        out.depth = 0.0f;
+        out.point = s.count > 0 ? s.v[0].b : vec3();
+        return true;
+    }
+
+    gjk_vertex v[EPA_MAX_VERTICES];
+    epa_face faces[EPA_MAX_FACES];
+    int num_vertices = 4, num_faces = 0;
+    for( int i = 0; i < 4; ++i ) v[i] = s.v[i];
+
+    // Wind the tetrahedron's faces away from its middle. After that new faces
+    // take their winding from the edge of the hole they fill, so they can't
+    // come out inside out when the polytope is thin.
+    const vec3 inside = ( v[0].w + v[1].w + v[2].w + v[3].w ) * 0.25f;
+    const int start[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+    for( int k = 0; k < 4; ++k )
+    {
+        int i0 = start[k][0], i1 = start[k][1], i2 = start[k][2];
+        if( ( v[i1].w - v[i0].w ).cross( v[i2].w - v[i0].w ).dot( v[i0].w - inside ) < 0.0f )
+            std::swap( i1, i2 );
+        if( epaMakeFace( v, i0, i1, i2, faces[num_faces] ) ) num_faces++;
+    }
+
+    auto nearestFace = [&]()
+    {
+        int nearest = 0;
+        for( int k = 1; k < num_faces; ++k )
+            if( faces[k].dist < faces[nearest].dist ) nearest = k;
+        return nearest;
+    };
+
+    for( int iteration = 0; iteration < EPA_MAX_VERTICES - 4; ++iteration )
+    {
+        const epa_face f = faces[nearestFace()];
+        gjk_vertex p = gjkSupport( a, b, f.normal );
+        if( p.w.dot( f.normal ) - f.dist < tolerance || num_vertices == EPA_MAX_VERTICES )
+            break;
+
+        // Take out every face the new point can see, keeping the edges round
+        // the hole. An edge shared by two removed faces shows up twice, in
+        // opposite directions, and isn't part of the hole. Faces the point is
+        // only in the plane of stay. Otherwise rounding can take one half of
+        // a flat side and not the other, and the hole comes out the wrong shape.
+        int edges[EPA_MAX_FACES * 3][2];
+        int num_edges = 0;
+        for( int k = 0; k < num_faces; )
+        {
+            if( faces[k].normal.dot( p.w - v[faces[k].i[0]].w ) > 1e-5f )
+            {
+                for( int e = 0; e < 3; ++e )
+                {
+                    int e0 = faces[k].i[e], e1 = faces[k].i[(e + 1) % 3];
+                    int found = -1;
+                    for( int m = 0; m < num_edges; ++m )
+                        if( edges[m][0] == e1 && edges[m][1] == e0 ) { found = m; break; }
+
+                    if( found >= 0 )
+                    {
+                        edges[found][0] = edges[num_edges - 1][0];
+                        edges[found][1] = edges[num_edges - 1][1];
+                        num_edges--;
+                    }
+                    else
+                    {
+                        edges[num_edges][0] = e0;
+                        edges[num_edges][1] = e1;
+                        num_edges++;
+                    }
+                }
+                faces[k] = faces[--num_faces];
+            }
+            else
+            {
+                ++k;
+            }
+        }
+
+        if( num_faces + num_edges > EPA_MAX_FACES )
+            break;
+
+        v[num_vertices] = p;
+        for( int m = 0; m < num_edges; ++m )
+            if( epaMakeFace( v, edges[m][0], edges[m][1], num_vertices, faces[num_faces] ) ) num_faces++;
+        num_vertices++;
+
+        if( num_faces == 0 )
+            return false;
+    }
+
+    if( num_faces == 0 )
+        return false;
+
+    const epa_face& f = faces[nearestFace()];
+
+    // Where the origin projects onto the face, as weights of its corners,
+    // gives the matching point on b
+    vec3 p0 = v[f.i[0]].w, p1 = v[f.i[1]].w, p2 = v[f.i[2]].w;
+    vec3 q = f.normal * f.dist;
+    vec3 e0 = p1 - p0, e1 = p2 - p0, e2 = q - p0;
+    float d00 = e0.dot( e0 ), d01 = e0.dot( e1 ), d11 = e1.dot( e1 ), d20 = e2.dot( e0 ), d21 = e2.dot( e1 );
+    float denom = d00*d11 - d01*d01;
+    float w1 = denom != 0.0f ? (d11*d20 - d01*d21) / denom : 0.0f;
+    float w2 = denom != 0.0f ? (d00*d21 - d01*d20) / denom : 0.0f;
+    float w0 = 1.0f - w1 - w2;
+
+    // A - B reaches furthest past the origin along the face normal, so that's
+    // the way a has to go back
+    out.normal = f.normal * -1.0f;
+    out.depth = f.dist;
+    out.point = v[f.i[0]].b * w0 + v[f.i[1]].b * w1 + v[f.i[2]].b * w2;
+    return true;
+}
+
+// GJK, then EPA if they overlap
+template<typename A, typename B>
+inline bool convexVsConvex( const A& a, const B& b, gjk_cache& cache, contact3& out )
+{
+    gjk_simplex s;
+    if( !gjk( a, b, cache, s ) )
+        return false;
+
+    return epa( a, b, s, out );
+}
+
+#endif
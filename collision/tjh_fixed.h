@@ -0,0 +1,542 @@
+#pragma once
+#ifndef TJH_FIXED_H
+#define TJH_FIXED_H
+
+// Fixed point math
+//
+// Floats can give different answers on different machines: the compiler may
+// keep values in wider registers, fuse a multiply and add, or reorder sums,
+// and std::sqrt / std::atan2 come from whichever maths library is linked. A
+// lockstep simulation needs every machine to get the same bits. Integers do,
+// so these store a number as an integer count of 1/2^16ths (q16, Q16.16) or
+// 1/2^32nds (q32, Q32.32) and do everything with integer operations:
+//
+// - * and / truncate towards zero, the same on every compiler
+// - sqrt() is exact, the largest value whose square doesn't go over (it
+//   starts from a double guess, but checks and fixes it with integers)
+// - sin(), cos() and atan2() use CORDIC: a fixed list of shifts and adds
+//   with a table of constants, no floating point anywhere
+//
+// The range is the catch. q16 goes to +-32767, so a squared length goes past
+// that once the vector is about 181 long: fine for metres, not for pixels.
+// q32 goes to +-2^31, so lengths up to about 46000 are safe. Pick the units
+// to suit.
+//
+// qvec2 / qvec3 are vec2 / vec3 made of either, with the same functions.
+// The collision tests at the bottom have the same names and arguments as the
+// float ones in tjh_collision.h, just with fixed point types. Only the four
+// scalar ones are here: circleTouchesSegment(), closestPointOnSegment(),
+// circleSegmentContact() and circleCircleContact(). The SoA batches
+// (circlesVsSegments()), sweeps, raycasts, broadphase, the parallel
+// narrowphase and everything in tjh_collision3d.h are float only, so a
+// lockstep game has to build its own loops over these.
+//
+// Converting from float is only deterministic if the floats are, so do it
+// when loading data (or use the integer constructor), not mid simulation.
+//
+// Right shifts of negative numbers are arithmetic on every compiler this is
+// built with (GCC, Clang and MSVC), which CORDIC relies on.
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "tjh_math.h"
+
+// The 64 bit types use 128 bit integers where the compiler has them, define
+// this as 0 to test the fallback, which gives the same answers
+#ifndef TJH_FIXED_INT128
+#if defined(__SIZEOF_INT128__)
+#define TJH_FIXED_INT128 1
+#else
+#define TJH_FIXED_INT128 0
+#endif
+#endif
+
+//
+// Raw integer operations
+//
+// Multiply and divide work on magnitudes and put the sign back afterwards, so
+// they truncate towards zero whichever path is used.
+//
+
+inline int32_t fixedMul( int32_t a, int32_t b, int frac )
+{
+    int64_t p = (int64_t)a * b;
+    return (int32_t)( p >= 0 ? p >> frac : -( -p >> frac ) );
+}
+
+inline int32_t fixedDiv( int32_t a, int32_t b, int frac )
+{
+    return (int32_t)( (int64_t)a * ( (int64_t)1 << frac ) / b );
+}
+
+inline int64_t fixedMul( int64_t a, int64_t b, int frac )
+{
+    bool negative = ( a < 0 ) != ( b < 0 );
+    uint64_t ua = a < 0 ? 0 - (uint64_t)a : (uint64_t)a;
+    uint64_t ub = b < 0 ? 0 - (uint64_t)b : (uint64_t)b;
+
+#if TJH_FIXED_INT128
+    uint64_t r = (uint64_t)( ( (unsigned __int128)ua * ub ) >> frac );
+#else
+    // 64 x 64 -> 128 from 32 bit halves
+    uint64_t a_lo = ua & 0xffffffff, a_hi = ua >> 32;
+    uint64_t b_lo = ub & 0xffffffff, b_hi = ub >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = ( lo_lo >> 32 ) + ( hi_lo & 0xffffffff ) + lo_hi;
+    uint64_t hi = hi_hi + ( hi_lo >> 32 ) + ( cross >> 32 );
+    uint64_t lo = ( cross << 32 ) | ( lo_lo & 0xffffffff );
+    uint64_t r = frac == 0 ? lo : ( hi << ( 64 - frac ) ) | ( lo >> frac );
+#endif
+    return negative ? -(int64_t)r : (int64_t)r;
+}
+
+inline int64_t fixedDiv( int64_t a, int64_t b, int frac )
+{
+    bool negative = ( a < 0 ) != ( b < 0 );
+    uint64_t ua = a < 0 ? 0 - (uint64_t)a : (uint64_t)a;
+    uint64_t ub = b < 0 ? 0 - (uint64_t)b : (uint64_t)b;
+
+#if TJH_FIXED_INT128
+    uint64_t r = (uint64_t)( ( (unsigned __int128)ua << frac ) / ub );
+#else
+    uint64_t r = 0;
+    if( frac == 0 )
+    {
+        r = ua / ub;
+    }
+    else if( ( ua >> ( 64 - frac ) ) == 0 )
+    {
+        r = ( ua << frac ) / ub;
+    }
+    else if( ( ub >> ( 64 - frac ) ) == 0 )
+    {
+        // Whole part and remainder separately, the remainder is small enough to shift
+        r = ( ( ua / ub ) << frac ) + ( ( ua % ub ) << frac ) / ub;
+    }
+    else
+    {
+        // Long division of ua * 2^frac, a bit at a time
+        uint64_t rem = 0;
+        for( int bit = 63 + frac; bit >= 0; --bit )
+        {
+            uint64_t next = bit >= frac ? ( ua >> ( bit - frac ) ) & 1 : 0;
+            bool carry = ( rem >> 63 ) != 0;
+            rem = ( rem << 1 ) | next;
+            r <<= 1;
+            if( carry || rem >= ub ) { rem -= ub; r |= 1; }
+        }
+    }
+#endif
+    return negative ? -(int64_t)r : (int64_t)r;
+}
+
+// Whether r * r > v * 2^shift, shift <= 32, r < 2^48. Both sides as hi * 2^32 + lo.
+inline bool fixedSquareAbove( uint64_t r, uint64_t v, int shift )
+{
+    uint64_t h = r >> 32, l = r & 0xffffffff;
+    uint64_t ll = l * l;
+    uint64_t hi = ( h * h << 32 ) + 2 * h * l + ( ll >> 32 ), lo = ll & 0xffffffff;
+    uint64_t v_hi = v >> ( 32 - shift ), v_lo = ( v << shift ) & 0xffffffff;
+    return hi > v_hi || ( hi == v_hi && lo > v_lo );
+}
+
+// floor(sqrt(v * 2^shift)). The double sqrt is only a guess, off by one at
+// most, which the integer checks then fix, so the answer doesn't depend on how
+// the machine rounds.
+inline uint64_t fixedSqrt( uint64_t v, int shift )
+{
+    uint64_t r = (uint64_t)std::sqrt( std::ldexp( (double)v, shift ) );
+    while( r > 0 && fixedSquareAbove( r, v, shift ) ) --r;
+    while( !fixedSquareAbove( r + 1, v, shift ) ) ++r;
+    return r;
+}
+
+//
+// CORDIC
+//
+// Turns a vector by +-atan(2^-i) for i = 0, 1, 2..., which is just a shift and
+// an add on each coordinate. Turning (K, 0) by an angle gives (cos, sin), and
+// turning (x, y) down to the x axis adds up its angle. Done with 32 fraction
+// bits for both types, then rounded to the one asked for.
+//
+
+const int CORDIC_STEPS = 33;
+
+// round(atan(2^-i) * 2^32)
+const int64_t CORDIC_ATAN[CORDIC_STEPS] = {
+    3373259426, 1991351318, 1052175346, 534100635, 268086748, 134174063, 67103403, 33553749,
+    16777131, 8388597, 4194303, 2097152, 1048576, 524288, 262144, 131072,
+    65536, 32768, 16384, 8192, 4096, 2048, 1024, 512,
+    256, 128, 64, 32, 16, 8, 4, 2, 1
+};
+
+const int64_t CORDIC_K      = 2608131496;   // 2^32 / the gain of all the steps
+const int64_t CORDIC_PI     = 13493037705;  // pi * 2^32
+const int64_t CORDIC_HALF_PI = 6746518852;
+const int64_t CORDIC_TWO_PI = 26986075409;
+
+// Steps needed for F fraction bits, each one adds about a bit
+inline int cordicSteps( int frac )
+{
+    return std::min( CORDIC_STEPS, frac + 2 );
+}
+
+// Cos and sin of `angle` (32 fraction bits), any angle
+inline void cordicSinCos( int64_t angle, int64_t& s, int64_t& c, int steps = CORDIC_STEPS )
+{
+    angle %= CORDIC_TWO_PI;
+    if( angle > CORDIC_PI ) angle -= CORDIC_TWO_PI;
+    if( angle < -CORDIC_PI ) angle += CORDIC_TWO_PI;
+
+    // CORDIC only reaches about +-99 degrees, mirror the rest in
+    bool flip = false;
+    if( angle > CORDIC_HALF_PI ) { angle = CORDIC_PI - angle; flip = true; }
+    else if( angle < -CORDIC_HALF_PI ) { angle = -CORDIC_PI - angle; flip = true; }
+
+    // Which way to turn is a coin toss every step, so it's done with a sign
+    // mask (0 or -1) instead of a branch: (v ^ m) - m is v or -v
+    int64_t x = CORDIC_K, y = 0;
+    for( int i = 0; i < steps; ++i )
+    {
+        int64_t dx = y >> i, dy = x >> i;
+        int64_t m = angle >> 63;
+        x -= ( dx ^ m ) - m;
+        y += ( dy ^ m ) - m;
+        angle -= ( CORDIC_ATAN[i] ^ m ) - m;
+    }
+
+    c = flip ? -x : x;
+    s = y;
+}
+
+// Angle of (x, y) with 32 fraction bits, between -pi and pi. Only the ratio
+// matters, so they can have any number of fraction bits as long as it's the same.
+inline int64_t cordicAtan2( int64_t y, int64_t x, int steps = CORDIC_STEPS )
+{
+    if( x == 0 && y == 0 )
+        return 0;
+
+    // Scale to about 2^60 so every step's shift still leaves something, and
+    // the growth (1.65x) can't overflow
+    uint64_t m = ( x < 0 ? 0 - (uint64_t)x : (uint64_t)x ) | ( y < 0 ? 0 - (uint64_t)y : (uint64_t)y );
+    while( m >= ( (uint64_t)1 << 60 ) ) { x /= 2; y /= 2; m >>= 1; }
+    while( m <  ( (uint64_t)1 << 59 ) ) { x *= 2; y *= 2; m <<= 1; }
+
+    // Into the right half first
+    int64_t angle = 0;
+    if( x < 0 )
+    {
+        int64_t t = x;
+        if( y >= 0 ) { x = y; y = -t; angle = CORDIC_HALF_PI; }
+        else         { x = -y; y = t; angle = -CORDIC_HALF_PI; }
+    }
+
+    for( int i = 0; i < steps; ++i )
+    {
+        int64_t dx = y >> i, dy = x >> i;
+        int64_t m = -y >> 63;   // -1 if y > 0
+        x -= ( dx ^ m ) - m;
+        y += ( dy ^ m ) - m;
+        angle -= ( CORDIC_ATAN[i] ^ m ) - m;
+    }
+    return angle;
+}
+
+//
+// Fixed point numbers
+//
+
+template<int FRAC, typename RAW>
+struct tfixed
+{
+    typedef RAW raw_type;
+
+    RAW raw;
+
+    static const int frac_bits = FRAC;
+    static const RAW one = (RAW)1 << FRAC;
+
+    tfixed() : raw(0) {}
+    explicit tfixed( int i ) : raw( (RAW)i * one ) {}
+    explicit tfixed( float f ) : raw( (RAW)( (double)f * (double)one ) ) {}
+    explicit tfixed( double d ) : raw( (RAW)( d * (double)one ) ) {}
+
+    static inline tfixed fromRaw( RAW r ) { tfixed f; f.raw = r; return f; }
+
+    inline float  toFloat()  const { return (float)( (double)raw / (double)one ); }
+    inline double toDouble() const { return (double)raw / (double)one; }
+    inline int    toInt()    const { return (int)( raw / one ); }
+
+    inline tfixed operator + ( tfixed rhs ) const { return fromRaw( raw + rhs.raw ); }
+    inline tfixed operator - ( tfixed rhs ) const { return fromRaw( raw - rhs.raw ); }
+    inline tfixed operator * ( tfixed rhs ) const { return fromRaw( fixedMul( raw, rhs.raw, FRAC ) ); }
+    inline tfixed operator / ( tfixed rhs ) const { return fromRaw( fixedDiv( raw, rhs.raw, FRAC ) ); }
+    inline tfixed operator - () const { return fromRaw( -raw ); }
+
+    inline tfixed& operator += ( tfixed rhs ) { raw += rhs.raw; return *this; }
+    inline tfixed& operator -= ( tfixed rhs ) { raw -= rhs.raw; return *this; }
+    inline tfixed& operator *= ( tfixed rhs ) { return *this = *this * rhs; }
+    inline tfixed& operator /= ( tfixed rhs ) { return *this = *this / rhs; }
+
+    inline bool operator == ( tfixed rhs ) const { return raw == rhs.raw; }
+    inline bool operator != ( tfixed rhs ) const { return raw != rhs.raw; }
+    inline bool operator <  ( tfixed rhs ) const { return raw <  rhs.raw; }
+    inline bool operator <= ( tfixed rhs ) const { return raw <= rhs.raw; }
+    inline bool operator >  ( tfixed rhs ) const { return raw >  rhs.raw; }
+    inline bool operator >= ( tfixed rhs ) const { return raw >= rhs.raw; }
+};
+
+typedef tfixed<16, int32_t> q16;
+typedef tfixed<32, int64_t> q32;
+
+template<int F, typename R>
+inline std::ostream& operator << ( std::ostream& os, tfixed<F, R> f ) { os << f.toDouble(); return os; }
+
+template<int F, typename R>
+inline tfixed<F, R> abs( tfixed<F, R> f ) { return f.raw < 0 ? -f : f; }
+
+// Largest value whose square is <= f, 0 for negatives
+template<int F, typename R>
+inline tfixed<F, R> sqrt( tfixed<F, R> f )
+{
+    if( f.raw <= 0 ) return tfixed<F, R>();
+    return tfixed<F, R>::fromRaw( (R)fixedSqrt( (uint64_t)f.raw, F ) );
+}
+
+// 32 fraction bits to F, rounded
+template<int F, typename R>
+inline tfixed<F, R> fromCordic( int64_t v )
+{
+    const int shift = 32 - F;
+    if( shift == 0 ) return tfixed<F, R>::fromRaw( (R)v );
+    const int64_t half = (int64_t)1 << ( shift > 0 ? shift - 1 : 0 );
+    return tfixed<F, R>::fromRaw( (R)( ( v + half ) >> shift ) );
+}
+
+template<int F, typename R>
+inline int64_t toCordic( tfixed<F, R> f )
+{
+    return (int64_t)f.raw * ( (int64_t)1 << ( 32 - F ) );
+}
+
+template<int F, typename R>
+inline tfixed<F, R> sin( tfixed<F, R> angle )
+{
+    int64_t s, c;
+    cordicSinCos( toCordic( angle ), s, c, cordicSteps( F ) );
+    return fromCordic<F, R>( s );
+}
+
+template<int F, typename R>
+inline tfixed<F, R> cos( tfixed<F, R> angle )
+{
+    int64_t s, c;
+    cordicSinCos( toCordic( angle ), s, c, cordicSteps( F ) );
+    return fromCordic<F, R>( c );
+}
+
+template<int F, typename R>
+inline tfixed<F, R> atan2( tfixed<F, R> y, tfixed<F, R> x )
+{
+    return fromCordic<F, R>( cordicAtan2( y.raw, x.raw, cordicSteps( F ) ) );
+}
+
+template<typename T> inline T fixedPi() { return fromCordic<T::frac_bits, typename T::raw_type>( CORDIC_PI ); }
+
+//
+// Vectors
+//
+
+template<typename T>
+struct qvec2
+{
+    T x, y;
+
+    qvec2() {}
+    qvec2( T x, T y ) : x(x), y(y) {}
+    explicit qvec2( const vec2& v ) : x( v.x ), y( v.y ) {}
+
+    inline vec2 toFloat() const { return vec2( x.toFloat(), y.toFloat() ); }
+
+    inline T dot( const qvec2& rhs )                 const { return x*rhs.x + y*rhs.y; }
+    inline T lengthSquared()                         const { return x*x + y*y; }
+    inline T length()                                const { return sqrt( lengthSquared() ); }
+    inline T distanceSquared( const qvec2& rhs )     const { return (*this - rhs).lengthSquared(); }
+    inline T distance( const qvec2& rhs )            const { return (*this - rhs).length(); }
+
+    // Zero stays zero
+    inline qvec2 normalized() const
+    {
+        T len = length();
+        if( len.raw == 0 ) return qvec2();
+        T inv = T( 1 ) / len;
+        return qvec2( x * inv, y * inv );
+    }
+
+    // Result is an angle in radians between -PI and PI
+    inline T angle( const qvec2& rhs ) const { return atan2( x*rhs.y - y*rhs.x, x*rhs.x + y*rhs.y ); }
+
+    inline qvec2& operator += ( const qvec2& rhs ) { x += rhs.x; y += rhs.y; return *this; }
+    inline qvec2& operator -= ( const qvec2& rhs ) { x -= rhs.x; y -= rhs.y; return *this; }
+
+    inline qvec2 operator + ( const qvec2& rhs ) const { return qvec2( x + rhs.x, y + rhs.y ); }
+    inline qvec2 operator - ( const qvec2& rhs ) const { return qvec2( x - rhs.x, y - rhs.y ); }
+
+    inline qvec2 operator * ( T f ) const { return qvec2( x*f, y*f ); }
+    inline qvec2 operator / ( T f ) const { return qvec2( x/f, y/f ); }
+
+    inline bool operator == ( const qvec2& rhs ) const { return x == rhs.x && y == rhs.y; }
+    inline bool operator != ( const qvec2& rhs ) const { return !( *this == rhs ); }
+};
+
+template<typename T>
+struct qvec3
+{
+    T x, y, z;
+
+    qvec3() {}
+    qvec3( T x, T y, T z ) : x(x), y(y), z(z) {}
+    explicit qvec3( const vec3& v ) : x( v.x ), y( v.y ), z( v.z ) {}
+
+    inline vec3 toFloat() const { return vec3( x.toFloat(), y.toFloat(), z.toFloat() ); }
+
+    inline T dot( const qvec3& rhs )    const { return x*rhs.x + y*rhs.y + z*rhs.z; }
+    inline qvec3 cross( const qvec3& rhs ) const { return qvec3( y*rhs.z - z*rhs.y, z*rhs.x - x*rhs.z, x*rhs.y - y*rhs.x ); }
+    inline T lengthSquared()            const { return x*x + y*y + z*z; }
+    inline T length()                   const { return sqrt( lengthSquared() ); }
+    inline T distanceSquared( const qvec3& rhs ) const { return (*this - rhs).lengthSquared(); }
+    inline T distance( const qvec3& rhs )        const { return (*this - rhs).length(); }
+
+    inline qvec3 normal() const
+    {
+        T len = length();
+        if( len.raw == 0 ) return qvec3();
+        T inv = T( 1 ) / len;
+        return qvec3( x * inv, y * inv, z * inv );
+    }
+
+    inline qvec3& operator += ( const qvec3& rhs ) { x += rhs.x; y += rhs.y; z += rhs.z; return *this; }
+    inline qvec3& operator -= ( const qvec3& rhs ) { x -= rhs.x; y -= rhs.y; z -= rhs.z; return *this; }
+
+    inline qvec3 operator + ( const qvec3& rhs ) const { return qvec3( x+rhs.x, y+rhs.y, z+rhs.z ); }
+    inline qvec3 operator - ( const qvec3& rhs ) const { return qvec3( x-rhs.x, y-rhs.y, z-rhs.z ); }
+    inline qvec3 operator * ( T f ) const { return qvec3( x*f, y*f, z*f ); }
+    inline qvec3 operator / ( T f ) const { return qvec3( x/f, y/f, z/f ); }
+
+    inline bool operator == ( const qvec3& rhs ) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+    inline bool operator != ( const qvec3& rhs ) const { return !( *this == rhs ); }
+};
+
+typedef qvec2<q16> vec2_q16;
+typedef qvec3<q16> vec3_q16;
+typedef qvec2<q32> vec2_q32;
+typedef qvec3<q32> vec3_q32;
+
+template<typename T>
+inline std::ostream& operator << ( std::ostream& os, const qvec2<T>& v ) { os << "(" << v.x << ", " << v.y << ")"; return os; }
+
+template<typename T>
+inline std::ostream& operator << ( std::ostream& os, const qvec3<T>& v ) { os << "(" << v.x << ", " << v.y << ", " << v.z << ")"; return os; }
+
+//
+// Collision
+//
+// The scalar tests from tjh_collision.h, see the top of the file for what
+// isn't covered. The float version of circle vs segment multiplies through to
+// avoid a divide, but that squares squared distances, which would overflow
+// here, so this one divides instead (t / dd is between 0 and 1 where it's
+// used).
+//
+
+template<typename T>
+struct qcontact
+{
+    int a, b;
+    qvec2<T> point;     // On the surface of b
+    qvec2<T> normal;    // Unit length, from b towards a
+    T depth;
+};
+
+template<int F, typename R>
+inline bool circleTouchesSegment( tfixed<F, R> cx, tfixed<F, R> cy, tfixed<F, R> r, tfixed<F, R> x1, tfixed<F, R> y1, tfixed<F, R> x2, tfixed<F, R> y2 )
+{
+    typedef tfixed<F, R> T;
+    T dx = x2 - x1, dy = y2 - y1;
+    T fx = cx - x1, fy = cy - y1;
+
+    T t  = fx*dx + fy*dy;
+    T dd = dx*dx + dy*dy;
+    T ff = fx*fx + fy*fy;
+    T rr = r*r;
+
+    if( t <= T() ) return ff < rr;
+    if( t >= dd )
+    {
+        T gx = cx - x2, gy = cy - y2;
+        return gx*gx + gy*gy < rr;
+    }
+    return ff - t * ( t / dd ) < rr;
+}
+
+template<int F, typename R>
+inline qvec2<tfixed<F, R>> closestPointOnSegment( tfixed<F, R> cx, tfixed<F, R> cy, tfixed<F, R> x1, tfixed<F, R> y1, tfixed<F, R> x2, tfixed<F, R> y2 )
+{
+    typedef tfixed<F, R> T;
+    T dx = x2 - x1, dy = y2 - y1;
+    T dd = dx*dx + dy*dy;
+    if( dd.raw == 0 ) return qvec2<T>( x1, y1 );
+
+    T t = ( (cx - x1)*dx + (cy - y1)*dy ) / dd;
+    t = t < T() ? T() : ( t > T( 1 ) ? T( 1 ) : t );
+    return qvec2<T>( x1 + dx*t, y1 + dy*t );
+}
+
+template<int F, typename R>
+inline bool circleSegmentContact( tfixed<F, R> cx, tfixed<F, R> cy, tfixed<F, R> r, tfixed<F, R> x1, tfixed<F, R> y1, tfixed<F, R> x2, tfixed<F, R> y2, qcontact<tfixed<F, R>>& out )
+{
+    typedef tfixed<F, R> T;
+    if( !circleTouchesSegment( cx, cy, r, x1, y1, x2, y2 ) )
+        return false;
+
+    qvec2<T> p = closestPointOnSegment( cx, cy, x1, y1, x2, y2 );
+    qvec2<T> n( cx - p.x, cy - p.y );
+    T dist = n.length();
+
+    if( dist.raw > 0 )
+    {
+        n = n / dist;
+    }
+    else
+    {
+        // Centre right on the segment, any side will do, take the left
+        n = qvec2<T>( y1 - y2, x2 - x1 ).normalized();
+        if( n.x.raw == 0 && n.y.raw == 0 ) n = qvec2<T>( T(), T( 1 ) );
+    }
+
+    out.point = p;
+    out.normal = n;
+    out.depth = r - dist;
+    return true;
+}
+
+template<int F, typename R>
+inline bool circleCircleContact( tfixed<F, R> ax, tfixed<F, R> ay, tfixed<F, R> ar, tfixed<F, R> bx, tfixed<F, R> by, tfixed<F, R> br, qcontact<tfixed<F, R>>& out )
+{
+    typedef tfixed<F, R> T;
+    qvec2<T> n( ax - bx, ay - by );
+    T r = ar + br;
+    if( n.lengthSquared() >= r*r )
+        return false;
+
+    T dist = n.length();
+    n = dist.raw > 0 ? n / dist : qvec2<T>( T(), T( 1 ) );
+
+    out.point = qvec2<T>( bx + n.x*br, by + n.y*br );
+    out.normal = n;
+    out.depth = r - dist;
+    return true;
+}
+
+#endif
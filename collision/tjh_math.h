@@ -20,10 +20,8 @@
 
 // If this is a good idea, maybe I could make it a proper thing, test against GLM?
 // MORE TYPES:
-// - aabb2, aabb3
 // - point2, point3
 // - circle, sphere
-// - matrix types!
 //
 // Other userfull things, see gb_math.h and HandmadeMath.h
 // Best of all is possibly linalg.h
@@ -32,14 +30,36 @@
 // - math constants
 // - interpolation of various kinds
 // - colour conversions RGB to HLS and HLS to RGB
-// - SSE
-// - watch for divide by zero error in sqrt normalizing
-// - overload '<<' stream operator for easy printing
+// - watch for divide by zero error in sqrt normalizing (vec2)
+// - SSE for vec3? It's 12 bytes, so it'd need padding to be worth it
+
+// SIMD:
+// vec4, quat and mat4 are 16 byte aligned and use SSE when the compiler has it
+// (any x64 build), otherwise plain floats. Define TJH_MATH_NO_SIMD before
+// including this to force the scalar code, e.g. to compare the two.
+
+// FAST MATH:
+// fastSqrt, fastRsqrt, fastAtan2, fastSin and fastCos trade a little accuracy
+// for speed, with array versions for doing lots at once. Errors are listed
+// with them. Define TJH_MATH_FAST before including this to make vec2 and
+// vec3 use them for length(), normalized() / normal() and angle().
 
 #include <cstdint>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <ostream>
 
+#if !defined(TJH_MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TJH_MATH_SSE 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define TJH_MATH_SSE 0
+#endif
+
 typedef uint8_t  u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
@@ -56,6 +76,234 @@ const float TWO_PI = 6.28318530718;
 const float DEG_TO_RAD = 0.01745329252;
 const float RAD_TO_DEG = 57.295779513;
 
+// Fast approximations of sqrt, 1/sqrt, atan2, sin and cos. Worst errors,
+// measured against the double versions:
+//
+//   fastRsqrt, fastSqrt     relative 3e-7 with SSE, 5e-6 without
+//   fastAtan2               2e-6 radians
+//   fastSin, fastCos        1e-7, for |x| < 10000 (past that the range
+//                           reduction starts losing bits)
+//
+// The array versions do the same sums four at a time with SSE, so they're
+// inside the same bounds, though not always bit for bit the same.
+//
+// fastRsqrt(0) is inf, same as 1 / std::sqrt(0), fastSqrt(0) and
+// fastAtan2(0, 0) are 0.
+//
+// std::sqrt is a single instruction on x64 and about as quick as fastSqrt
+// one at a time, fastSqrt is there for the array version.
+
+// Two halves of PI / 2 for range reduction, the first has few enough bits
+// that k * the first is exact
+const float TJH_HALF_PI_HI = 1.5703125f;
+const float TJH_HALF_PI_MID = 4.8375129699707031e-4f;
+const float TJH_HALF_PI_LO = 7.5497899548918822e-8f;
+
+// atan(z) ~= z * (A0 + A1 z^2 + ... + A5 z^10) for 0 <= z <= 1, fitted for least worst error
+const float TJH_ATAN_A0 =  9.999772191e-01f;
+const float TJH_ATAN_A1 = -3.326228259e-01f;
+const float TJH_ATAN_A2 =  1.935403544e-01f;
+const float TJH_ATAN_A3 = -1.164264139e-01f;
+const float TJH_ATAN_A4 =  5.264726784e-02f;
+const float TJH_ATAN_A5 = -1.171910030e-02f;
+
+// sin and cos on [-PI/4, PI/4], from Cephes
+const float TJH_SIN_S1 = -1.6666654611e-1f;
+const float TJH_SIN_S2 =  8.3321608736e-3f;
+const float TJH_SIN_S3 = -1.9515295891e-4f;
+const float TJH_COS_C1 =  4.166664568298827e-2f;
+const float TJH_COS_C2 = -1.388731625493765e-3f;
+const float TJH_COS_C3 =  2.443315711809948e-5f;
+
+inline float fastRsqrt( float x )
+{
+#if TJH_MATH_SSE
+    float r = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( x ) ) );
+#else
+    // The bit trick guess is only good to 3.5%, so it gets an extra step
+    u32 i;
+    std::memcpy( &i, &x, 4 );
+    i = 0x5f375a86 - ( i >> 1 );
+    float r;
+    std::memcpy( &r, &i, 4 );
+    r = r * ( 1.5f - 0.5f * x * r * r );
+#endif
+    // One Newton step, which can't be trusted at 0. With SSE that's 0 * inf
+    // and without, the guess wasn't inf in the first place.
+    r = r * ( 1.5f - 0.5f * x * r * r );
+    return x == 0.0f ? HUGE_VALF : r;
+}
+
+inline float fastSqrt( float x )
+{
+    return x > 0.0f ? x * fastRsqrt( x ) : 0.0f;
+}
+
+// mask ? a : b for a mask of all 1s or all 0s, on the bits, since compilers
+// turn ?: on floats into branches and the fast functions' choices are coin tosses
+inline float tjh_select( u32 mask, float a, float b )
+{
+    u32 ba, bb;
+    std::memcpy( &ba, &a, 4 );
+    std::memcpy( &bb, &b, 4 );
+    u32 r = ( ba & mask ) | ( bb & ~mask );
+    float f;
+    std::memcpy( &f, &r, 4 );
+    return f;
+}
+
+inline float fastAtan2( float y, float x )
+{
+    float ax = std::fabs( x ), ay = std::fabs( y );
+    float hi = std::max( ax, ay ), lo = std::min( ax, ay );
+    float z = tjh_select( 0u - (u32)( hi > 0.0f ), lo / hi, 0.0f );
+    float z2 = z * z;
+
+    float a = z * ( TJH_ATAN_A0 + z2 * ( TJH_ATAN_A1 + z2 * ( TJH_ATAN_A2 + z2 * ( TJH_ATAN_A3 + z2 * ( TJH_ATAN_A4 + z2 * TJH_ATAN_A5 ) ) ) ) );
+    a = tjh_select( 0u - (u32)( ay > ax ), 0.5f * PI - a, a );
+    a = tjh_select( 0u - (u32)( x < 0.0f ), PI - a, a );
+    return std::copysign( a, y );
+}
+
+inline void fastSinCos( float x, float& s, float& c )
+{
+    // x = k * PI/2 + r, with r between -PI/4 and PI/4
+#if TJH_MATH_SSE
+    int k = _mm_cvtss_si32( _mm_set_ss( x * ( 2.0f / PI ) ) );
+#else
+    int k = (int)std::lrint( x * ( 2.0f / PI ) );
+#endif
+    float fk = (float)k;
+    float r = ( ( x - fk * TJH_HALF_PI_HI ) - fk * TJH_HALF_PI_MID ) - fk * TJH_HALF_PI_LO;
+    float r2 = r * r;
+
+    float sr = r + r * r2 * ( TJH_SIN_S1 + r2 * ( TJH_SIN_S2 + r2 * TJH_SIN_S3 ) );
+    float cr = 1.0f - 0.5f * r2 + r2 * r2 * ( TJH_COS_C1 + r2 * ( TJH_COS_C2 + r2 * TJH_COS_C3 ) );
+
+    // Each quarter turn swaps sin and cos and flips one of them: odd quarters
+    // swap, sin flips in quarters 2 and 3, cos in 1 and 2
+    u32 swap = 0u - (u32)( k & 1 );
+    s = tjh_select( swap, cr, sr );
+    c = tjh_select( swap, sr, cr );
+    s = tjh_select( 0u - (u32)( ( k >> 1 ) & 1 ), -s, s );
+    c = tjh_select( 0u - (u32)( ( ( k + 1 ) >> 1 ) & 1 ), -c, c );
+}
+
+inline float fastSin( float x ) { float s, c; fastSinCos( x, s, c ); return s; }
+inline float fastCos( float x ) { float s, c; fastSinCos( x, s, c ); return c; }
+
+// Array versions, in and out can be the same array
+
+inline void fastRsqrt( const float* in, float* out, int count )
+{
+    int i = 0;
+#if TJH_MATH_SSE
+    const __m128 half = _mm_set1_ps( 0.5f ), three_halves = _mm_set1_ps( 1.5f ), zero = _mm_setzero_ps(), inf = _mm_set1_ps( HUGE_VALF );
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( in + i );
+        __m128 r = _mm_rsqrt_ps( x );
+        r = _mm_mul_ps( r, _mm_sub_ps( three_halves, _mm_mul_ps( _mm_mul_ps( half, x ), _mm_mul_ps( r, r ) ) ) );
+        __m128 is_zero = _mm_cmpeq_ps( x, zero );
+        _mm_storeu_ps( out + i, _mm_or_ps( _mm_and_ps( is_zero, inf ), _mm_andnot_ps( is_zero, r ) ) );
+    }
+#endif
+    for( ; i < count; ++i ) out[i] = fastRsqrt( in[i] );
+}
+
+inline void fastSqrt( const float* in, float* out, int count )
+{
+    int i = 0;
+#if TJH_MATH_SSE
+    const __m128 half = _mm_set1_ps( 0.5f ), three_halves = _mm_set1_ps( 1.5f ), zero = _mm_setzero_ps();
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( in + i );
+        __m128 r = _mm_rsqrt_ps( x );
+        r = _mm_mul_ps( r, _mm_sub_ps( three_halves, _mm_mul_ps( _mm_mul_ps( half, x ), _mm_mul_ps( r, r ) ) ) );
+        _mm_storeu_ps( out + i, _mm_and_ps( _mm_mul_ps( x, r ), _mm_cmpgt_ps( x, zero ) ) );
+    }
+#endif
+    for( ; i < count; ++i ) out[i] = fastSqrt( in[i] );
+}
+
+inline void fastAtan2( const float* y, const float* x, float* out, int count )
+{
+    int i = 0;
+#if TJH_MATH_SSE
+    const __m128 sign = _mm_set1_ps( -0.0f ), zero = _mm_setzero_ps();
+    const __m128 pi = _mm_set1_ps( PI ), half_pi = _mm_set1_ps( 0.5f * PI );
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 vy = _mm_loadu_ps( y + i ), vx = _mm_loadu_ps( x + i );
+        __m128 ax = _mm_andnot_ps( sign, vx ), ay = _mm_andnot_ps( sign, vy );
+        __m128 hi = _mm_max_ps( ax, ay ), lo = _mm_min_ps( ax, ay );
+        __m128 z = _mm_and_ps( _mm_div_ps( lo, hi ), _mm_cmpgt_ps( hi, zero ) );
+        __m128 z2 = _mm_mul_ps( z, z );
+
+        __m128 p = _mm_add_ps( _mm_set1_ps( TJH_ATAN_A4 ), _mm_mul_ps( z2, _mm_set1_ps( TJH_ATAN_A5 ) ) );
+        p = _mm_add_ps( _mm_set1_ps( TJH_ATAN_A3 ), _mm_mul_ps( z2, p ) );
+        p = _mm_add_ps( _mm_set1_ps( TJH_ATAN_A2 ), _mm_mul_ps( z2, p ) );
+        p = _mm_add_ps( _mm_set1_ps( TJH_ATAN_A1 ), _mm_mul_ps( z2, p ) );
+        p = _mm_add_ps( _mm_set1_ps( TJH_ATAN_A0 ), _mm_mul_ps( z2, p ) );
+        __m128 a = _mm_mul_ps( z, p );
+
+        // No blend in SSE2, so select with and / andnot / or
+        __m128 steep = _mm_cmpgt_ps( ay, ax );
+        a = _mm_or_ps( _mm_and_ps( steep, _mm_sub_ps( half_pi, a ) ), _mm_andnot_ps( steep, a ) );
+        __m128 left = _mm_cmplt_ps( vx, zero );
+        a = _mm_or_ps( _mm_and_ps( left, _mm_sub_ps( pi, a ) ), _mm_andnot_ps( left, a ) );
+        _mm_storeu_ps( out + i, _mm_or_ps( a, _mm_and_ps( sign, vy ) ) );
+    }
+#endif
+    for( ; i < count; ++i ) out[i] = fastAtan2( y[i], x[i] );
+}
+
+inline void fastSinCos( const float* angles, float* s, float* c, int count )
+{
+    int i = 0;
+#if TJH_MATH_SSE
+    const __m128i one = _mm_set1_epi32( 1 ), two = _mm_set1_epi32( 2 );
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( angles + i );
+        __m128i k = _mm_cvtps_epi32( _mm_mul_ps( x, _mm_set1_ps( 2.0f / PI ) ) ); // Rounds to nearest
+        __m128 fk = _mm_cvtepi32_ps( k );
+        __m128 r = _mm_sub_ps( x, _mm_mul_ps( fk, _mm_set1_ps( TJH_HALF_PI_HI ) ) );
+        r = _mm_sub_ps( r, _mm_mul_ps( fk, _mm_set1_ps( TJH_HALF_PI_MID ) ) );
+        r = _mm_sub_ps( r, _mm_mul_ps( fk, _mm_set1_ps( TJH_HALF_PI_LO ) ) );
+        __m128 r2 = _mm_mul_ps( r, r );
+
+        __m128 ps = _mm_add_ps( _mm_set1_ps( TJH_SIN_S2 ), _mm_mul_ps( r2, _mm_set1_ps( TJH_SIN_S3 ) ) );
+        ps = _mm_add_ps( _mm_set1_ps( TJH_SIN_S1 ), _mm_mul_ps( r2, ps ) );
+        __m128 sr = _mm_add_ps( r, _mm_mul_ps( _mm_mul_ps( r, r2 ), ps ) );
+
+        __m128 pc = _mm_add_ps( _mm_set1_ps( TJH_COS_C2 ), _mm_mul_ps( r2, _mm_set1_ps( TJH_COS_C3 ) ) );
+        pc = _mm_add_ps( _mm_set1_ps( TJH_COS_C1 ), _mm_mul_ps( r2, pc ) );
+        __m128 cr = _mm_add_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), _mm_mul_ps( _mm_set1_ps( 0.5f ), r2 ) ), _mm_mul_ps( _mm_mul_ps( r2, r2 ), pc ) );
+
+        // Quarters as in the scalar version
+        __m128 swap = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( k, one ), one ) );
+        __m128 vs = _mm_or_ps( _mm_and_ps( swap, cr ), _mm_andnot_ps( swap, sr ) );
+        __m128 vc = _mm_or_ps( _mm_and_ps( swap, sr ), _mm_andnot_ps( swap, cr ) );
+        __m128 flip_s = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( k, two ), 30 ) );
+        __m128 flip_c = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( _mm_add_epi32( k, one ), two ), 30 ) );
+        _mm_storeu_ps( s + i, _mm_xor_ps( vs, flip_s ) );
+        _mm_storeu_ps( c + i, _mm_xor_ps( vc, flip_c ) );
+    }
+#endif
+    for( ; i < count; ++i ) fastSinCos( angles[i], s[i], c[i] );
+}
+
+// What vec2 and vec3 use for lengths, normalizing and angles
+#ifdef TJH_MATH_FAST
+inline float tjh_sqrt( float x ) { return fastSqrt( x ); }
+inline float tjh_atan2( float y, float x ) { return fastAtan2( y, x ); }
+#else
+inline float tjh_sqrt( float x ) { return std::sqrt( x ); }
+inline float tjh_atan2( float y, float x ) { return std::atan2( y, x ); }
+#endif
+
 struct vec3
 {
     union {
@@ -70,6 +318,18 @@ struct vec3
 
     inline float dot( const vec3& rhs )  const { return x*rhs.x + y*rhs.y + z*rhs.z; }
     inline vec3 cross( const vec3& rhs ) const { return vec3( y*rhs.z - z*rhs.y, z*rhs.x - x*rhs.z, x*rhs.y - y*rhs.x ); }
+#ifdef TJH_MATH_FAST
+    inline vec3 normal() const {
+        float len2 = lengthSquared();
+        if( len2 == 0.0f ) return vec3();
+        else return *this * fastRsqrt( len2 );
+    }
+    inline vec3& normalize() {
+        float len2 = lengthSquared();
+        if( len2 != 0.0f ) *this *= fastRsqrt( len2 );
+        return *this;
+    }
+#else
     inline vec3 normal() const {
         float len = length();
         if( len == 0.0f ) return vec3();
@@ -80,8 +340,9 @@ struct vec3
         if( len != 0.0f ) { x /= len; y /= len; z /= len; }
         return *this;
     }
+#endif
     inline float lengthSquared() const { return x*x + y*y + z*z; }
-    inline float length()        const { return std::sqrt( lengthSquared() ); }
+    inline float length()        const { return tjh_sqrt( lengthSquared() ); }
     inline float distanceSquared( const vec3& rhs ) const { return (*this - rhs).lengthSquared(); }
     inline float distance( const vec3& rhs )        const { return (*this - rhs).length(); }
 
@@ -110,7 +371,7 @@ struct vec3
 
 };
 
-std::ostream& operator << ( std::ostream& os, const vec3& v ) { os << "(" << v.x << ", " << v.y << ", " << v.z << ")"; return os; }
+inline std::ostream& operator << ( std::ostream& os, const vec3& v ) { os << "(" << v.x << ", " << v.y << ", " << v.z << ")"; return os; }
 
 struct vec2
 {
@@ -122,13 +383,17 @@ struct vec2
     inline float dot( const vec2& rhs )             const { return x*rhs.x + y*rhs.y; }
 
     inline float lengthSquared()                    const { return x * x + y * y; }
-    inline float length()                           const { return std::sqrt( lengthSquared() ); }
+    inline float length()                           const { return tjh_sqrt( lengthSquared() ); }
     inline float distanceSquared( const vec2& rhs ) const { return (*this - rhs).lengthSquared(); }
     inline float distance( const vec2& rhs )        const { return (*this - rhs).length(); }
+#ifdef TJH_MATH_FAST
+    inline vec2  normalized()                       const { float len2 = lengthSquared(); return len2 == 0.0f ? vec2() : *this * fastRsqrt( len2 ); }
+#else
     inline vec2  normalized()                       const { return *this / length(); }
+#endif
 
     // Result is an angle in radians between -PI and PI
-    inline float angle( const vec2& rhs ) { return std::atan2(x*rhs.y-y*rhs.x, x*rhs.x+y*rhs.y); }
+    inline float angle( const vec2& rhs ) { return tjh_atan2(x*rhs.y-y*rhs.x, x*rhs.x+y*rhs.y); }
 
     inline vec2& operator += ( const vec2& rhs ) { x += rhs.x; y += rhs.y; return *this; }
     inline vec2& operator -= ( const vec2& rhs ) { x -= rhs.x; y -= rhs.y; return *this; }
@@ -140,4 +405,308 @@ struct vec2
     inline vec2 operator / ( float f ) const { return vec2( x/f, y/f ); }
 };
 
+struct aabb2
+{
+    vec2 min, max;
+
+    aabb2() {}
+    aabb2( const vec2& min, const vec2& max ) : min(min), max(max) {}
+
+    inline vec2 center()  const { return (min + max) * 0.5f; }
+    inline vec2 extents() const { return (max - min) * 0.5f; }
+    inline float perimeter() const { return 2.0f * ( (max.x - min.x) + (max.y - min.y) ); }
+
+    inline bool overlaps( const aabb2& rhs ) const { return min.x <= rhs.max.x && rhs.min.x <= max.x && min.y <= rhs.max.y && rhs.min.y <= max.y; }
+    inline bool contains( const aabb2& rhs ) const { return min.x <= rhs.min.x && min.y <= rhs.min.y && rhs.max.x <= max.x && rhs.max.y <= max.y; }
+
+    inline aabb2 merged( const aabb2& rhs ) const {
+        return aabb2( vec2( min.x < rhs.min.x ? min.x : rhs.min.x, min.y < rhs.min.y ? min.y : rhs.min.y ),
+                      vec2( max.x > rhs.max.x ? max.x : rhs.max.x, max.y > rhs.max.y ? max.y : rhs.max.y ) );
+    }
+    inline aabb2 expanded( float margin ) const { return aabb2( vec2( min.x - margin, min.y - margin ), vec2( max.x + margin, max.y + margin ) ); }
+};
+
+struct aabb3
+{
+    vec3 min, max;
+
+    aabb3() {}
+    aabb3( const vec3& min, const vec3& max ) : min(min), max(max) {}
+
+    inline vec3 center()  const { return (min + max) * 0.5f; }
+    inline vec3 extents() const { return (max - min) * 0.5f; }
+    inline float surfaceArea() const { vec3 d = max - min; return 2.0f * ( d.x*d.y + d.y*d.z + d.z*d.x ); }
+
+    inline bool overlaps( const aabb3& rhs ) const {
+        return min.x <= rhs.max.x && rhs.min.x <= max.x && min.y <= rhs.max.y && rhs.min.y <= max.y && min.z <= rhs.max.z && rhs.min.z <= max.z;
+    }
+    inline bool contains( const vec3& p ) const {
+        return min.x <= p.x && p.x <= max.x && min.y <= p.y && p.y <= max.y && min.z <= p.z && p.z <= max.z;
+    }
+
+    // The point in the box nearest to p, p itself if it's inside
+    inline vec3 closestPoint( const vec3& p ) const {
+        return vec3( p.x < min.x ? min.x : ( p.x > max.x ? max.x : p.x ),
+                     p.y < min.y ? min.y : ( p.y > max.y ? max.y : p.y ),
+                     p.z < min.z ? min.z : ( p.z > max.z ? max.z : p.z ) );
+    }
+
+    inline aabb3 merged( const aabb3& rhs ) const {
+        return aabb3( vec3( min.x < rhs.min.x ? min.x : rhs.min.x, min.y < rhs.min.y ? min.y : rhs.min.y, min.z < rhs.min.z ? min.z : rhs.min.z ),
+                      vec3( max.x > rhs.max.x ? max.x : rhs.max.x, max.y > rhs.max.y ? max.y : rhs.max.y, max.z > rhs.max.z ? max.z : rhs.max.z ) );
+    }
+    inline aabb3 expanded( float margin ) const { return aabb3( min - margin, max + margin ); }
+};
+
+#if TJH_MATH_SSE
+// Helpers for the SSE paths, lanes are x, y, z, w
+#define TJH_SHUFFLE( v, x, y, z, w ) _mm_shuffle_ps( (v), (v), _MM_SHUFFLE( (w), (z), (y), (x) ) )
+
+// x*x' + y*y' + z*z' + w*w' in every lane
+inline __m128 tjh_dot4( __m128 a, __m128 b )
+{
+    __m128 m = _mm_mul_ps( a, b );
+    m = _mm_add_ps( m, TJH_SHUFFLE( m, 1, 0, 3, 2 ) );
+    return _mm_add_ps( m, TJH_SHUFFLE( m, 2, 3, 0, 1 ) );
+}
+
+// Cross product of the xyz parts, w comes out as 0
+inline __m128 tjh_cross3( __m128 a, __m128 b )
+{
+    __m128 a_yzx = TJH_SHUFFLE( a, 1, 2, 0, 3 );
+    __m128 b_yzx = TJH_SHUFFLE( b, 1, 2, 0, 3 );
+    __m128 c = _mm_sub_ps( _mm_mul_ps( a, b_yzx ), _mm_mul_ps( a_yzx, b ) );
+    return TJH_SHUFFLE( c, 1, 2, 0, 3 );
+}
+
+// Index of the lowest set bit, for walking the lanes of a movemask. The mask
+// mustn't be 0.
+inline int tjh_ctz( unsigned mask )
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward( &index, mask );
+    return (int)index;
+#else
+    return __builtin_ctz( mask );
+#endif
+}
+#endif
+
+struct alignas(16) vec4
+{
+    union {
+        struct { float x; float y; float z; float w; };
+        struct { float r; float g; float b; float a; };
+        float e[4];
+#if TJH_MATH_SSE
+        __m128 m;
+#endif
+    };
+
+    vec4() : x(0), y(0), z(0), w(0) {}
+    vec4( float x, float y, float z, float w ) : x(x), y(y), z(z), w(w) {}
+    explicit vec4( const vec3& v, float w = 0.0f ) : x(v.x), y(v.y), z(v.z), w(w) {}
+#if TJH_MATH_SSE
+    explicit vec4( __m128 m ) : m(m) {}
+#endif
+
+    inline vec3 xyz() const { return vec3( x, y, z ); }
+
+#if TJH_MATH_SSE
+    inline float dot( const vec4& rhs )  const { return _mm_cvtss_f32( tjh_dot4( m, rhs.m ) ); }
+    inline vec4 cross( const vec4& rhs ) const { return vec4( tjh_cross3( m, rhs.m ) ); }
+    inline vec4 normal() const {
+        __m128 len = _mm_sqrt_ps( tjh_dot4( m, m ) );
+        if( _mm_cvtss_f32( len ) == 0.0f ) return vec4();
+        else return vec4( _mm_div_ps( m, len ) );
+    }
+#else
+    inline float dot( const vec4& rhs )  const { return x*rhs.x + y*rhs.y + z*rhs.z + w*rhs.w; }
+    // Cross product of the xyz parts, w is 0
+    inline vec4 cross( const vec4& rhs ) const { return vec4( y*rhs.z - z*rhs.y, z*rhs.x - x*rhs.z, x*rhs.y - y*rhs.x, 0.0f ); }
+    inline vec4 normal() const {
+        float len = length();
+        if( len == 0.0f ) return vec4();
+        else return vec4( x / len, y / len, z / len, w / len );
+    }
+#endif
+    inline vec4& normalize() { *this = normal(); return *this; }
+    inline float lengthSquared() const { return dot( *this ); }
+    inline float length()        const { return std::sqrt( lengthSquared() ); }
+    inline float distanceSquared( const vec4& rhs ) const { return (*this - rhs).lengthSquared(); }
+    inline float distance( const vec4& rhs )        const { return (*this - rhs).length(); }
+
+    inline bool operator == ( const vec4& rhs ) const { return x == rhs.x && y == rhs.y && z == rhs.z && w == rhs.w; }
+    inline bool operator != ( const vec4& rhs ) const { return ! (*this == rhs) ; }
+
+#if TJH_MATH_SSE
+    inline vec4 operator + ( const vec4& rhs ) const { return vec4( _mm_add_ps( m, rhs.m ) ); }
+    inline vec4 operator - ( const vec4& rhs ) const { return vec4( _mm_sub_ps( m, rhs.m ) ); }
+    inline vec4 operator * ( const vec4& rhs ) const { return vec4( _mm_mul_ps( m, rhs.m ) ); }
+    inline vec4 operator / ( const vec4& rhs ) const { return vec4( _mm_div_ps( m, rhs.m ) ); }
+
+    inline vec4 operator + ( float f ) const { return vec4( _mm_add_ps( m, _mm_set1_ps( f ) ) ); }
+    inline vec4 operator - ( float f ) const { return vec4( _mm_sub_ps( m, _mm_set1_ps( f ) ) ); }
+    inline vec4 operator * ( float f ) const { return vec4( _mm_mul_ps( m, _mm_set1_ps( f ) ) ); }
+    inline vec4 operator / ( float f ) const { return vec4( _mm_div_ps( m, _mm_set1_ps( f ) ) ); }
+#else
+    inline vec4 operator + ( const vec4& rhs ) const { return vec4( x+rhs.x, y+rhs.y, z+rhs.z, w+rhs.w ); }
+    inline vec4 operator - ( const vec4& rhs ) const { return vec4( x-rhs.x, y-rhs.y, z-rhs.z, w-rhs.w ); }
+    inline vec4 operator * ( const vec4& rhs ) const { return vec4( x*rhs.x, y*rhs.y, z*rhs.z, w*rhs.w ); }
+    inline vec4 operator / ( const vec4& rhs ) const { return vec4( x/rhs.x, y/rhs.y, z/rhs.z, w/rhs.w ); }
+
+    inline vec4 operator + ( float f ) const { return vec4( x+f, y+f, z+f, w+f ); }
+    inline vec4 operator - ( float f ) const { return vec4( x-f, y-f, z-f, w-f ); }
+    inline vec4 operator * ( float f ) const { return vec4( x*f, y*f, z*f, w*f ); }
+    inline vec4 operator / ( float f ) const { return vec4( x/f, y/f, z/f, w/f ); }
+#endif
+
+    inline vec4& operator += ( const vec4& rhs ) { return *this = *this + rhs; }
+    inline vec4& operator -= ( const vec4& rhs ) { return *this = *this - rhs; }
+    inline vec4& operator *= ( const vec4& rhs ) { return *this = *this * rhs; }
+    inline vec4& operator /= ( const vec4& rhs ) { return *this = *this / rhs; }
+
+    inline vec4& operator += ( float f ) { return *this = *this + f; }
+    inline vec4& operator -= ( float f ) { return *this = *this - f; }
+    inline vec4& operator *= ( float f ) { return *this = *this * f; }
+    inline vec4& operator /= ( float f ) { return *this = *this / f; }
+};
+
+inline std::ostream& operator << ( std::ostream& os, const vec4& v ) { os << "(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")"; return os; }
+
+// Rotation, x, y, z is the axis times sin(angle/2) and w is cos(angle/2)
+struct alignas(16) quat
+{
+    union {
+        struct { float x; float y; float z; float w; };
+        float e[4];
+        vec4 v;
+    };
+
+    quat() : x(0), y(0), z(0), w(1) {}
+    quat( float x, float y, float z, float w ) : x(x), y(y), z(z), w(w) {}
+    explicit quat( const vec4& v ) : v(v) {}
+
+    // `axis` must be unit length, `angle` is in radians
+    static inline quat axisAngle( const vec3& axis, float angle ) {
+        float s = std::sin( angle * 0.5f );
+        return quat( axis.x * s, axis.y * s, axis.z * s, std::cos( angle * 0.5f ) );
+    }
+
+    inline quat conjugate() const { return quat( -x, -y, -z, w ); }
+    inline quat normal()    const { return quat( v.normal() ); }
+    inline float dot( const quat& rhs ) const { return v.dot( rhs.v ); }
+
+    // Applies rhs first, then this
+#if TJH_MATH_SSE
+    inline quat operator * ( const quat& rhs ) const {
+        const __m128 b = rhs.v.m;
+        __m128 r = _mm_mul_ps( _mm_set1_ps( w ), b );
+        r = _mm_add_ps( r, _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( x ), TJH_SHUFFLE( b, 3, 2, 1, 0 ) ), _mm_setr_ps(  1, -1,  1, -1 ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( y ), TJH_SHUFFLE( b, 2, 3, 0, 1 ) ), _mm_setr_ps(  1,  1, -1, -1 ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( z ), TJH_SHUFFLE( b, 1, 0, 3, 2 ) ), _mm_setr_ps( -1,  1,  1, -1 ) ) );
+        return quat( vec4( r ) );
+    }
+#else
+    inline quat operator * ( const quat& rhs ) const {
+        return quat( w*rhs.x + x*rhs.w + y*rhs.z - z*rhs.y,
+                     w*rhs.y - x*rhs.z + y*rhs.w + z*rhs.x,
+                     w*rhs.z + x*rhs.y - y*rhs.x + z*rhs.w,
+                     w*rhs.w - x*rhs.x - y*rhs.y - z*rhs.z );
+    }
+#endif
+
+    // Rotates `p`, the quaternion must be unit length
+    inline vec4 rotate( const vec4& p ) const {
+#if TJH_MATH_SSE
+        // Masking off w rather than building u from floats, that would write
+        // four floats then read them back as one, which stalls
+        vec4 u( _mm_and_ps( v.m, _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) ) ) );
+#else
+        vec4 u( x, y, z, 0.0f );
+#endif
+        vec4 t = u.cross( p ) * 2.0f;
+        return p + t * w + u.cross( t );
+    }
+    inline vec3 rotate( const vec3& p ) const { return rotate( vec4( p ) ).xyz(); }
+};
+
+inline std::ostream& operator << ( std::ostream& os, const quat& q ) { os << "(" << q.x << ", " << q.y << ", " << q.z << ", " << q.w << ")"; return os; }
+
+// Column major, like OpenGL: c[3] is the translation and a point is
+// transformed as M * vec4(p, 1)
+struct alignas(16) mat4
+{
+    vec4 c[4];
+
+    mat4() : c{ vec4(1,0,0,0), vec4(0,1,0,0), vec4(0,0,1,0), vec4(0,0,0,1) } {}
+    mat4( const vec4& c0, const vec4& c1, const vec4& c2, const vec4& c3 ) : c{ c0, c1, c2, c3 } {}
+
+    static inline mat4 identity() { return mat4(); }
+
+    static inline mat4 translation( const vec3& t ) {
+        mat4 m;
+        m.c[3] = vec4( t, 1.0f );
+        return m;
+    }
+
+    static inline mat4 scale( const vec3& s ) {
+        return mat4( vec4(s.x,0,0,0), vec4(0,s.y,0,0), vec4(0,0,s.z,0), vec4(0,0,0,1) );
+    }
+
+    // `q` must be unit length
+    static inline mat4 rotation( const quat& q ) {
+        float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+        float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+        float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+        return mat4( vec4( 1 - 2*(yy + zz), 2*(xy + wz),     2*(xz - wy),     0 ),
+                     vec4( 2*(xy - wz),     1 - 2*(xx + zz), 2*(yz + wx),     0 ),
+                     vec4( 2*(xz + wy),     2*(yz - wx),     1 - 2*(xx + yy), 0 ),
+                     vec4( 0, 0, 0, 1 ) );
+    }
+
+    inline float& operator () ( int row, int col )       { return c[col].e[row]; }
+    inline float  operator () ( int row, int col ) const { return c[col].e[row]; }
+
+    inline mat4 transposed() const {
+        mat4 t;
+        for( int i = 0; i < 4; ++i )
+            for( int j = 0; j < 4; ++j )
+                t.c[i].e[j] = c[j].e[i];
+        return t;
+    }
+
+#if TJH_MATH_SSE
+    inline vec4 operator * ( const vec4& v ) const {
+        __m128 r = _mm_mul_ps( c[0].m, TJH_SHUFFLE( v.m, 0, 0, 0, 0 ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c[1].m, TJH_SHUFFLE( v.m, 1, 1, 1, 1 ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c[2].m, TJH_SHUFFLE( v.m, 2, 2, 2, 2 ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c[3].m, TJH_SHUFFLE( v.m, 3, 3, 3, 3 ) ) );
+        return vec4( r );
+    }
+#else
+    inline vec4 operator * ( const vec4& v ) const {
+        return vec4( c[0].x*v.x + c[1].x*v.y + c[2].x*v.z + c[3].x*v.w,
+                     c[0].y*v.x + c[1].y*v.y + c[2].y*v.z + c[3].y*v.w,
+                     c[0].z*v.x + c[1].z*v.y + c[2].z*v.z + c[3].z*v.w,
+                     c[0].w*v.x + c[1].w*v.y + c[2].w*v.z + c[3].w*v.w );
+    }
+#endif
+
+    // Applies rhs first, then this
+    inline mat4 operator * ( const mat4& rhs ) const {
+        return mat4( *this * rhs.c[0], *this * rhs.c[1], *this * rhs.c[2], *this * rhs.c[3] );
+    }
+
+    inline vec3 transformPoint( const vec3& p )  const { return (*this * vec4( p, 1.0f )).xyz(); }
+    inline vec3 transformVector( const vec3& v ) const { return (*this * vec4( v, 0.0f )).xyz(); }
+};
+
+inline std::ostream& operator << ( std::ostream& os, const mat4& m ) {
+    for( int row = 0; row < 4; ++row )
+        os << (row ? "\n[" : "[") << m(row, 0) << ", " << m(row, 1) << ", " << m(row, 2) << ", " << m(row, 3) << "]";
+    return os;
+}
+
 #endif
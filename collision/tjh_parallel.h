@@ -0,0 +1,147 @@
+#pragma once
+#ifndef TJH_PARALLEL_H
+#define TJH_PARALLEL_H
+
+// Multithreaded narrowphase
+//
+// Once the broadphase has made its list of pairs, every pair can be tested on
+// its own, so the list is cut into fixed size chunks and a pool of worker
+// threads takes chunks until there are none left. Each worker appends its
+// contacts to its own buffer, so nothing is shared while testing.
+//
+// Which worker gets which chunk changes from run to run, so every chunk
+// remembers where its contacts ended up. The merge then copies them out in
+// chunk order, which is the same order the single threaded version gives, for
+// any number of threads.
+//
+// The threads come from a worker_pool (tjh_worker_pool.h), which sleeps
+// between runs rather than being started each frame. The per worker buffers
+// keep their memory between calls, so after the first few frames nothing
+// allocates.
+
+#include <vector>
+
+#include "tjh_collision.h"
+#include "tjh_worker_pool.h"
+
+//
+// Narrowphase
+//
+
+struct narrowphase_chunk
+{
+    int worker;     // Whose buffer its contacts are in
+    int begin;      // First of them
+    int count;
+    int out;        // Where they go in the merged buffer
+};
+
+// Padded out so two workers growing their buffers don't share a cache line
+struct alignas(64) worker_contacts
+{
+    std::vector<contact> contacts;
+};
+
+// Scratch space kept between calls, one per thing calling at the same time
+struct narrowphase_buffers
+{
+    int chunk_size = 4096;  // Pairs per chunk, big enough to make taking one cheap
+
+    std::vector<worker_contacts> workers;
+    std::vector<narrowphase_chunk> chunks;
+    contact overflow;
+};
+
+// Runs test(pair, contact&) over the candidates on every worker and writes
+// the contacts to `contacts` in candidate order
+template<typename Test>
+inline void parallelContacts( worker_pool& pool, narrowphase_buffers& b, const std::vector<collision_pair>& candidates, contact_buffer& contacts, Test test )
+{
+    const int count = (int)candidates.size();
+
+    // Nobody to share with, skip the copying
+    if( workerCount( pool ) == 1 )
+    {
+        for( const collision_pair& p : candidates )
+        {
+            contact* out = contacts.count < contacts.capacity() ? &contacts.contacts[contacts.count] : &b.overflow;
+            if( test( p, *out ) && contacts.add() )
+            {
+                out->a = p.a;
+                out->b = p.b;
+            }
+        }
+        return;
+    }
+
+    const int num_chunks = ( count + b.chunk_size - 1 ) / b.chunk_size;
+
+    b.workers.resize( workerCount( pool ) );
+    for( worker_contacts& w : b.workers )
+        w.contacts.clear();
+    b.chunks.resize( num_chunks );
+
+    poolFor( pool, num_chunks, [&]( int worker, int chunk )
+    {
+        std::vector<contact>& out = b.workers[worker].contacts;
+        const int begin = chunk * b.chunk_size;
+        const int end = std::min( begin + b.chunk_size, count );
+        const int first = (int)out.size();
+
+        contact c;
+        for( int k = begin; k < end; ++k )
+        {
+            const collision_pair& p = candidates[k];
+            if( test( p, c ) )
+            {
+                c.a = p.a;
+                c.b = p.b;
+                out.push_back( c );
+            }
+        }
+
+        b.chunks[chunk] = { worker, first, (int)out.size() - first, 0 };
+    } );
+
+    // Chunk order decides where everything goes, whoever did the work
+    int total = contacts.count;
+    for( narrowphase_chunk& chunk : b.chunks )
+    {
+        chunk.out = total;
+        total += chunk.count;
+    }
+
+    const int capacity = contacts.capacity();
+    poolFor( pool, num_chunks, [&]( int, int i )
+    {
+        const narrowphase_chunk& chunk = b.chunks[i];
+        const int n = std::max( 0, std::min( chunk.count, capacity - chunk.out ) );
+        if( n > 0 )
+            std::copy_n( b.workers[chunk.worker].contacts.begin() + chunk.begin, n, contacts.contacts.begin() + chunk.out );
+    } );
+
+    contacts.dropped += std::max( 0, total - capacity );
+    contacts.count = std::min( total, capacity );
+}
+
+// circlesVsSegments() on every worker, same contacts in the same order
+inline void circlesVsSegmentsParallel( worker_pool& pool, narrowphase_buffers& b, const circle_soa& c, const segment_soa& s,
+                                       const std::vector<collision_pair>& candidates, contact_buffer& contacts )
+{
+    parallelContacts( pool, b, candidates, contacts, [&]( const collision_pair& p, contact& out )
+    {
+        return circleSegmentContact( c.x[p.a], c.y[p.a], c.radius[p.a], s.x1[p.b], s.y1[p.b], s.x2[p.b], s.y2[p.b], out );
+    } );
+}
+
+// circlesVsCircles() on every worker, same contacts in the same order
+inline void circlesVsCirclesParallel( worker_pool& pool, narrowphase_buffers& b, const circle_soa& c,
+                                      const std::vector<collision_pair>& candidates, contact_buffer& contacts )
+{
+    parallelContacts( pool, b, candidates, contacts, [&]( const collision_pair& p, contact& out )
+    {
+        return circleCircleContact( c.x[p.a], c.y[p.a], c.radius[p.a], c.x[p.b], c.y[p.b], c.radius[p.b], out );
+    } );
+}
+
+#endif
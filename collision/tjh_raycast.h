@@ -0,0 +1,333 @@
+#pragma once
+#ifndef TJH_RAYCAST_H
+#define TJH_RAYCAST_H
+
+// Batch ray casts
+//
+// Line of sight and the like: lots of rays against the same level every
+// frame, each one only wanting the nearest thing it hits.
+//
+// Segments don't move, so a ray walks the segment_grid one cell at a time in
+// the order it passes through them (Amanatides & Woo) and stops as soon as it
+// has a hit nearer than the far side of the cell it's in. Each cell's segments
+// are copied out next to each other (segment_cells) so the ray is tested
+// against 8 (AVX) or 4 (SSE) of them at once.
+//
+// Circles move, so they go in an aabb_tree with the circle's index as the
+// proxy's user, and the ray walks that with treeRayCast(), shortening itself
+// at each hit.
+//
+// Rays are shared out between a worker_pool's workers in small chunks. Each
+// ray only writes its own hit, so the results are the same for any number of
+// workers.
+//
+// Both only replace hits nearer than the one already there, so clear the hits
+// with clearRayHits() and then cast against segments and circles, in either
+// order, to get the nearest of both.
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tjh_collision.h"
+#include "tjh_broadphase.h"
+#include "tjh_aabb_tree.h"
+#include "tjh_worker_pool.h"
+
+// Ray i goes from (x[i], y[i]) to (x[i] + dx[i], y[i] + dy[i])
+struct ray_soa
+{
+    std::vector<float> x, y, dx, dy;
+
+    inline int size() const { return (int)x.size(); }
+    inline void add( float ox, float oy, float rx, float ry ) { x.push_back( ox ); y.push_back( oy ); dx.push_back( rx ); dy.push_back( ry ); }
+    inline void clear() { x.clear(); y.clear(); dx.clear(); dy.clear(); }
+};
+
+struct ray_hit
+{
+    int segment = -1;   // What it hit, at most one of these is set
+    int circle = -1;
+    float t = 1.0f;     // Fraction along the ray, 1 when it hit nothing
+    vec2 point;
+    vec2 normal;        // Unit length, facing back towards the ray's start
+};
+
+inline void clearRayHits( std::vector<ray_hit>& hits, int count )
+{
+    hits.assign( count, ray_hit() );
+}
+
+// Rays per chunk of work, enough that taking one is cheap next to doing it
+const int RAYCAST_CHUNK = 32;
+
+//
+// Segments
+//
+
+// segment_grid::items with the segment's ends in place of its index
+struct segment_cells
+{
+    std::vector<float> x1, y1, x2, y2;
+};
+
+inline void buildSegmentCells( segment_cells& sc, const segment_grid& g, const segment_soa& s )
+{
+    const int count = (int)g.items.size();
+    sc.x1.resize( count ); sc.y1.resize( count );
+    sc.x2.resize( count ); sc.y2.resize( count );
+
+    for( int k = 0; k < count; ++k )
+    {
+        int j = g.items[k];
+        sc.x1[k] = s.x1[j]; sc.y1[k] = s.y1[j];
+        sc.x2[k] = s.x2[j]; sc.y2[k] = s.y2[j];
+    }
+}
+
+// Narrows [t0, t1] to where o + d*t is between lo and hi, false if that leaves nothing
+inline bool raySlab( float o, float d, float lo, float hi, float& t0, float& t1 )
+{
+    if( d == 0.0f )
+        return o >= lo && o <= hi;
+
+    float a = ( lo - o ) / d, b = ( hi - o ) / d;
+    if( a > b ) std::swap( a, b );
+    t0 = std::max( t0, a );
+    t1 = std::min( t1, b );
+    return t0 <= t1;
+}
+
+#if !defined(TJH_MATH_NO_SIMD) && defined(__AVX__)
+
+// One ray against cell segments [begin, end) 8 at a time, keeping the nearest
+// crossing before best_t. Returns how far it got.
+inline int rayVsCellSegmentsSimd( float ox, float oy, float dx, float dy, const segment_cells& sc, int begin, int end, float& best_t, int& best_k )
+{
+    const __m256 vox = _mm256_set1_ps( ox ), voy = _mm256_set1_ps( oy );
+    const __m256 vdx = _mm256_set1_ps( dx ), vdy = _mm256_set1_ps( dy );
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps( 1.0f );
+
+    int k = begin;
+    for( ; k + 8 <= end; k += 8 )
+    {
+        __m256 x1 = _mm256_loadu_ps( &sc.x1[k] ), y1 = _mm256_loadu_ps( &sc.y1[k] );
+        __m256 ex = _mm256_sub_ps( _mm256_loadu_ps( &sc.x2[k] ), x1 ), ey = _mm256_sub_ps( _mm256_loadu_ps( &sc.y2[k] ), y1 );
+        __m256 wx = _mm256_sub_ps( x1, vox ), wy = _mm256_sub_ps( y1, voy );
+
+        // Parallel segments divide by 0, the NaNs and infinities fail the compares
+        __m256 denom = _mm256_sub_ps( _mm256_mul_ps( vdx, ey ), _mm256_mul_ps( vdy, ex ) );
+        __m256 t = _mm256_div_ps( _mm256_sub_ps( _mm256_mul_ps( wx, ey ), _mm256_mul_ps( wy, ex ) ), denom );
+        __m256 u = _mm256_div_ps( _mm256_sub_ps( _mm256_mul_ps( wx, vdy ), _mm256_mul_ps( wy, vdx ) ), denom );
+
+        __m256 hit = _mm256_and_ps( _mm256_cmp_ps( t, zero, _CMP_GE_OQ ), _mm256_cmp_ps( t, _mm256_set1_ps( best_t ), _CMP_LT_OQ ) );
+        hit = _mm256_and_ps( hit, _mm256_and_ps( _mm256_cmp_ps( u, zero, _CMP_GE_OQ ), _mm256_cmp_ps( u, one, _CMP_LE_OQ ) ) );
+
+        int mask = _mm256_movemask_ps( hit );
+        if( mask )
+        {
+            alignas(32) float ts[8];
+            _mm256_store_ps( ts, t );
+            while( mask )
+            {
+                int bit = tjh_ctz( mask );
+                if( ts[bit] < best_t ) { best_t = ts[bit]; best_k = k + bit; }
+                mask &= mask - 1;
+            }
+        }
+    }
+    return k;
+}
+
+#elif TJH_MATH_SSE
+
+// One ray against cell segments [begin, end) 4 at a time, keeping the nearest
+// crossing before best_t. Returns how far it got.
+inline int rayVsCellSegmentsSimd( float ox, float oy, float dx, float dy, const segment_cells& sc, int begin, int end, float& best_t, int& best_k )
+{
+    const __m128 vox = _mm_set1_ps( ox ), voy = _mm_set1_ps( oy );
+    const __m128 vdx = _mm_set1_ps( dx ), vdy = _mm_set1_ps( dy );
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f );
+
+    int k = begin;
+    for( ; k + 4 <= end; k += 4 )
+    {
+        __m128 x1 = _mm_loadu_ps( &sc.x1[k] ), y1 = _mm_loadu_ps( &sc.y1[k] );
+        __m128 ex = _mm_sub_ps( _mm_loadu_ps( &sc.x2[k] ), x1 ), ey = _mm_sub_ps( _mm_loadu_ps( &sc.y2[k] ), y1 );
+        __m128 wx = _mm_sub_ps( x1, vox ), wy = _mm_sub_ps( y1, voy );
+
+        // Parallel segments divide by 0, the NaNs and infinities fail the compares
+        __m128 denom = _mm_sub_ps( _mm_mul_ps( vdx, ey ), _mm_mul_ps( vdy, ex ) );
+        __m128 t = _mm_div_ps( _mm_sub_ps( _mm_mul_ps( wx, ey ), _mm_mul_ps( wy, ex ) ), denom );
+        __m128 u = _mm_div_ps( _mm_sub_ps( _mm_mul_ps( wx, vdy ), _mm_mul_ps( wy, vdx ) ), denom );
+
+        __m128 hit = _mm_and_ps( _mm_cmpge_ps( t, zero ), _mm_cmplt_ps( t, _mm_set1_ps( best_t ) ) );
+        hit = _mm_and_ps( hit, _mm_and_ps( _mm_cmpge_ps( u, zero ), _mm_cmple_ps( u, one ) ) );
+
+        int mask = _mm_movemask_ps( hit );
+        if( mask )
+        {
+            alignas(16) float ts[4];
+            _mm_store_ps( ts, t );
+            while( mask )
+            {
+                int bit = tjh_ctz( mask );
+                if( ts[bit] < best_t ) { best_t = ts[bit]; best_k = k + bit; }
+                mask &= mask - 1;
+            }
+        }
+    }
+    return k;
+}
+
+#else
+
+inline int rayVsCellSegmentsSimd( float, float, float, float, const segment_cells&, int begin, int, float&, int& ) { return begin; }
+
+#endif
+
+// Casts one ray through the grid, replacing `hit` if it finds a nearer segment
+inline void raycastSegments( const segment_grid& g, const segment_cells& sc, float ox, float oy, float dx, float dy, ray_hit& hit )
+{
+    if( g.width == 0 )
+        return;
+
+    const float size = g.cell_size;
+
+    // The part of the ray inside the grid, and before the hit it already has
+    float t_enter = 0.0f, t_exit = hit.t;
+    if( !raySlab( ox, dx, g.min_x, g.min_x + g.width * size, t_enter, t_exit ) ||
+        !raySlab( oy, dy, g.min_y, g.min_y + g.height * size, t_enter, t_exit ) )
+        return;
+
+    int cx = std::min( std::max( (int)( ( ox + dx * t_enter - g.min_x ) / size ), 0 ), g.width - 1 );
+    int cy = std::min( std::max( (int)( ( oy + dy * t_enter - g.min_y ) / size ), 0 ), g.height - 1 );
+
+    // Where the ray crosses the next column and row boundary, and how far
+    // apart the crossings are
+    const int step_x = dx > 0.0f ? 1 : -1, step_y = dy > 0.0f ? 1 : -1;
+    float next_x = dx == 0.0f ? INFINITY : ( g.min_x + ( cx + ( dx > 0.0f ) ) * size - ox ) / dx;
+    float next_y = dy == 0.0f ? INFINITY : ( g.min_y + ( cy + ( dy > 0.0f ) ) * size - oy ) / dy;
+    const float delta_x = dx == 0.0f ? INFINITY : size / std::fabs( dx );
+    const float delta_y = dy == 0.0f ? INFINITY : size / std::fabs( dy );
+
+    float best_t = hit.t;
+    int best_k = -1;
+
+    for(;;)
+    {
+        int cell = cy * g.width + cx;
+        int end = g.cell_start[cell + 1];
+
+        int k = rayVsCellSegmentsSimd( ox, oy, dx, dy, sc, g.cell_start[cell], end, best_t, best_k );
+        for( ; k < end; ++k )
+        {
+            float t = rayVsSegment( ox, oy, dx, dy, sc.x1[k], sc.y1[k], sc.x2[k], sc.y2[k] );
+            if( t >= 0.0f && t < best_t ) { best_t = t; best_k = k; }
+        }
+
+        // Segments only found in later cells are further away than this one's far side
+        float t_leave = std::min( next_x, next_y );
+        if( best_t <= t_leave || t_leave >= t_exit )
+            break;
+
+        if( next_x < next_y )
+        {
+            cx += step_x;
+            if( cx < 0 || cx >= g.width ) break;
+            next_x += delta_x;
+        }
+        else
+        {
+            cy += step_y;
+            if( cy < 0 || cy >= g.height ) break;
+            next_y += delta_y;
+        }
+    }
+
+    if( best_k < 0 )
+        return;
+
+    vec2 normal( sc.y1[best_k] - sc.y2[best_k], sc.x2[best_k] - sc.x1[best_k] );
+    normal = normal / normal.length();
+    if( normal.x * dx + normal.y * dy > 0.0f ) normal = normal * -1.0f;
+
+    hit.segment = g.items[best_k];
+    hit.circle = -1;
+    hit.t = best_t;
+    hit.point = vec2( ox + dx * best_t, oy + dy * best_t );
+    hit.normal = normal;
+}
+
+// Casts every ray, hits[i] is replaced if ray i finds a nearer segment.
+// Needs buildSegmentCells() for the grid's current segments.
+inline void raycastSegments( worker_pool& pool, const segment_grid& g, const segment_cells& sc, const ray_soa& rays, std::vector<ray_hit>& hits )
+{
+    const int count = rays.size();
+    hits.resize( count );
+
+    poolFor( pool, ( count + RAYCAST_CHUNK - 1 ) / RAYCAST_CHUNK, [&]( int, int chunk )
+    {
+        const int end = std::min( ( chunk + 1 ) * RAYCAST_CHUNK, count );
+        for( int i = chunk * RAYCAST_CHUNK; i < end; ++i )
+            raycastSegments( g, sc, rays.x[i], rays.y[i], rays.dx[i], rays.dy[i], hits[i] );
+    } );
+}
+
+//
+// Circles
+//
+
+// Casts one ray through the tree, replacing `hit` if it finds a nearer circle.
+// Proxies' user must be the circle's index.
+inline void raycastCircles( const aabb_tree& tree, const circle_soa& c, float ox, float oy, float dx, float dy, ray_hit& hit )
+{
+    if( hit.t <= 0.0f )
+        return;
+
+    // The tree works in fractions of the ray it's given, which stops at the
+    // hit we already have
+    const float scale = hit.t;
+    float best_t = hit.t;
+    int best = -1;
+
+    treeRayCast( tree, vec2( ox, oy ), vec2( ox + dx * scale, oy + dy * scale ), [&]( int proxy, float max_fraction )
+    {
+        int i = tree.nodes[proxy].user;
+        float t = rayVsCircle( ox, oy, dx, dy, c.x[i], c.y[i], c.radius[i] );
+        if( t < 0.0f || t >= best_t )
+            return max_fraction;
+
+        best_t = t;
+        best = i;
+        return t / scale;
+    } );
+
+    if( best < 0 )
+        return;
+
+    hit.segment = -1;
+    hit.circle = best;
+    hit.t = best_t;
+    hit.point = vec2( ox + dx * best_t, oy + dy * best_t );
+    // From the centre rather than from the point, which has lost precision
+    // to the size of the coordinates
+    vec2 normal( ox - c.x[best] + dx * best_t, oy - c.y[best] + dy * best_t );
+    hit.normal = normal / normal.length();
+}
+
+// Casts every ray, hits[i] is replaced if ray i finds a nearer circle
+inline void raycastCircles( worker_pool& pool, const aabb_tree& tree, const circle_soa& c, const ray_soa& rays, std::vector<ray_hit>& hits )
+{
+    const int count = rays.size();
+    hits.resize( count );
+
+    poolFor( pool, ( count + RAYCAST_CHUNK - 1 ) / RAYCAST_CHUNK, [&]( int, int chunk )
+    {
+        const int end = std::min( ( chunk + 1 ) * RAYCAST_CHUNK, count );
+        for( int i = chunk * RAYCAST_CHUNK; i < end; ++i )
+            raycastCircles( tree, c, rays.x[i], rays.y[i], rays.dx[i], rays.dy[i], hits[i] );
+    } );
+}
+
+#endif
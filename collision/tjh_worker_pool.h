@@ -0,0 +1,155 @@
+#pragma once
+#ifndef TJH_WORKER_POOL_H
+#define TJH_WORKER_POOL_H
+
+// Worker pool
+//
+// A few threads kept around to share out work. Starting threads costs more
+// than a lot of the jobs they're given, so the helpers are started once and
+// sleep between runs. The calling thread always works too, as worker 0, so one
+// worker means no helper threads at all.
+//
+// Doesn't depend on the rest of the collision code, so other projects in the
+// repo include it on its own.
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+struct worker_pool
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+
+    // The job for the current run, called with the worker's index
+    void (*job)( void* data, int worker ) = nullptr;
+    void* job_data = nullptr;
+
+    int generation = 0;     // Bumped each run so sleeping workers know there's a new job
+    int running = 0;        // Helpers still busy with this run
+    bool quit = false;
+
+    worker_pool() {}
+    worker_pool( const worker_pool& ) = delete;
+    worker_pool& operator = ( const worker_pool& ) = delete;
+    inline ~worker_pool();
+};
+
+// Workers including the calling thread, which always works as worker 0
+inline int workerCount( const worker_pool& p )
+{
+    return (int)p.threads.size() + 1;
+}
+
+// `seen` is the generation when the worker was started, so a restarted pool
+// doesn't pick up the last job from before the restart
+inline void poolWorker( worker_pool& p, int index, int seen )
+{
+    std::unique_lock<std::mutex> lock( p.mutex );
+
+    for(;;)
+    {
+        p.wake.wait( lock, [&]() { return p.quit || p.generation != seen; } );
+        if( p.quit )
+            return;
+
+        seen = p.generation;
+        lock.unlock();
+
+        p.job( p.job_data, index );
+
+        lock.lock();
+        if( --p.running == 0 )
+            p.finished.notify_one();
+    }
+}
+
+inline void poolStop( worker_pool& p )
+{
+    {
+        std::lock_guard<std::mutex> lock( p.mutex );
+        p.quit = true;
+    }
+    p.wake.notify_all();
+
+    for( std::thread& t : p.threads )
+        t.join();
+
+    p.threads.clear();
+    p.quit = false;
+}
+
+// Starts `workers` - 1 helper threads, 0 or 1 runs everything on the caller
+inline void poolStart( worker_pool& p, int workers )
+{
+    poolStop( p );
+
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock( p.mutex );
+        generation = p.generation;
+    }
+    for( int i = 1; i < workers; ++i )
+        p.threads.emplace_back( poolWorker, std::ref( p ), i, generation );
+}
+
+inline worker_pool::~worker_pool()
+{
+    poolStop( *this );
+}
+
+// Calls f(worker) once on every worker and waits for them all to finish
+template<typename F>
+inline void poolRun( worker_pool& p, F& f )
+{
+    if( p.threads.empty() )
+    {
+        f( 0 );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( p.mutex );
+        p.job = []( void* data, int worker ) { (*(F*)data)( worker ); };
+        p.job_data = &f;
+        p.running = (int)p.threads.size();
+        p.generation++;
+    }
+    p.wake.notify_all();
+
+    f( 0 );
+
+    std::unique_lock<std::mutex> lock( p.mutex );
+    p.finished.wait( lock, [&]() { return p.running == 0; } );
+
+    // `f` is about to go out of scope
+    p.job = nullptr;
+    p.job_data = nullptr;
+}
+
+// Calls f(worker, i) for every i in [0, count), shared out between the workers
+template<typename F>
+inline void poolFor( worker_pool& p, int count, F f )
+{
+    std::atomic<int> next( 0 );
+
+    auto work = [&]( int worker )
+    {
+        for(;;)
+        {
+            int i = next.fetch_add( 1 );
+            if( i >= count )
+                break;
+
+            f( worker, i );
+        }
+    };
+
+    poolRun( p, work );
+}
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "curve.h"
+#include "spline_batch.h"
+#include "../collision/tjh_worker_pool.h"
+
+//
+// Agents following curves
+//
+// Lots of things moving along paths at their own speed. They're stored as
+// struct-of-arrays so a chunk of agents is a handful of tight loops: advance
+// every distance, turn every distance into a t with the arc length table
+// (starting from last update's t, so it's rarely a full search), then
+// turn runs of t values on the same curve into positions with pointsOnCurve().
+//
+// updateAgents() splits the agents into chunks and hands them out to the
+// agents' worker_pool (shared with the collision code), which is started on
+// the first update and kept until the number of threads asked for changes.
+// Each chunk only touches its own slice of the arrays and the curves are only
+// read, so there's no locking. The curves need updateArcLengths() and
+// updateCoefficients() before the update.
+//
+// Keep agents on the same curve next to each other (addAgents() does) so the
+// batches passed to pointsOnCurve() stay long.
+//
+
+struct Agents
+{
+    std::vector<int> curve;     // Index into the array of curves
+    std::vector<float> s;       // Distance along the curve in pixels
+    std::vector<float> speed;   // Pixels per second, negative goes backwards
+
+    // Written by updateAgents()
+    std::vector<float> t;
+    std::vector<float> x, y;
+
+    worker_pool pool;
+};
+
+inline int agentCount(const Agents& a)
+{
+    return (int)a.s.size();
+}
+
+// Adds `count` agents spread randomly along `curve`
+inline void addAgents(Agents& a, int curve, float curve_length, int count, float min_speed, float max_speed)
+{
+    const int first = agentCount(a);
+    const int total = first + count;
+
+    a.curve.resize(total, curve);
+    a.s.resize(total);
+    a.speed.resize(total);
+    a.t.resize(total);
+    a.x.resize(total);
+    a.y.resize(total);
+
+    for(int i = first; i < total; ++i)
+    {
+        a.s[i] = (rand() / (float)RAND_MAX) * curve_length;
+        a.speed[i] = min_speed + (rand() / (float)RAND_MAX) * (max_speed - min_speed);
+        a.t[i] = 0.0f;
+    }
+}
+
+inline void clearAgents(Agents& a)
+{
+    a.curve.clear();
+    a.s.clear();
+    a.speed.clear();
+    a.t.clear();
+    a.x.clear();
+    a.y.clear();
+}
+
+// Updates agents [begin, end)
+inline void updateAgentRange(Agents& a, const Curve* curves, float dt, int begin, int end)
+{
+    // Move, wrapping round at the ends of the curve
+    for(int i = begin; i < end; ++i)
+    {
+        const float length = curveLength(curves[a.curve[i]]);
+
+        float s = a.s[i] + a.speed[i] * dt;
+        if(s >= length || s < 0.0f)
+        {
+            s = length > 0.0f ? s - std::floor(s / length) * length : 0.0f;
+        }
+        a.s[i] = s;
+    }
+
+    // Last update's t is a good place to start looking from
+    for(int i = begin; i < end; ++i)
+    {
+        a.t[i] = tAtDistanceNear(curves[a.curve[i]], a.s[i], a.t[i]);
+    }
+
+    // Positions, a run of agents on the same curve at a time
+    int run = begin;
+    while(run < end)
+    {
+        const int id = a.curve[run];
+
+        int run_end = run + 1;
+        while(run_end < end && a.curve[run_end] == id) run_end++;
+
+        pointsOnCurve(curves[id], &a.t[run], run_end - run, &a.x[run], &a.y[run]);
+        run = run_end;
+    }
+}
+
+// Advances every agent by `dt` seconds and works out their positions
+inline void updateAgents(Agents& a, const Curve* curves, float dt, int threads)
+{
+    // Big enough to make handing out a chunk cheap, small enough to balance
+    const int chunk_size = 4096;
+
+    threads = std::max(1, threads);
+    if(workerCount(a.pool) != threads)
+    {
+        poolStart(a.pool, threads);
+    }
+
+    const int count = agentCount(a);
+    const int chunks = (count + chunk_size - 1) / chunk_size;
+
+    // One chunk isn't worth waking anyone for
+    if(chunks <= 1)
+    {
+        updateAgentRange(a, curves, dt, 0, count);
+        return;
+    }
+
+    poolFor(a.pool, chunks, [&](int, int chunk)
+    {
+        const int begin = chunk * chunk_size;
+        updateAgentRange(a, curves, dt, begin, std::min(begin + chunk_size, count));
+    });
+}
@@ -0,0 +1,350 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "curve.h"
+#include "spline_batch.h"
+#include "curve_bvh.h"
+#include "agents.h"
+#include "path_file.h"
+#include "vec2_batch.h"
+#include "reparam.h"
+
+//
+// Benchmarks for the spline code that doesn't need a window.
+// Build with `build_bench.sh`, which also turns on the instruction sets the
+// SIMD paths need.
+//
+
+template<typename F>
+double bestOf(int runs, F f)
+{
+    double best = 1e9;
+    for(int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+Curve randomCurve(SplineType type, int numPoints)
+{
+    Curve c;
+    setType(c, type);
+    for(int i = 0; i < numPoints; ++i)
+    {
+        addPoint(c, vec2(i * 10.0f, (rand() / (float)RAND_MAX) * 500.0f));
+    }
+    return c;
+}
+
+void benchBatchEvaluation()
+{
+    // A frame's worth of samples, evaluated over and over so the timing isn't
+    // just measuring memory bandwidth
+    const int num_samples = 4096;
+    const int repeats = 256;
+
+    printf("pointOnCurve() vs pointsOnCurve(), %d samples x %d\n", num_samples, repeats);
+
+    for(int type = 0; type < SPLINE_TYPE_COUNT; ++type)
+    {
+        Curve c = randomCurve((SplineType)type, 1000);
+        updateCoefficients(c);
+
+        std::vector<float> t(num_samples), x(num_samples), y(num_samples);
+        for(int i = 0; i < num_samples; ++i)
+        {
+            t[i] = (rand() / (float)RAND_MAX) * maxT(c);
+        }
+
+        double single_ms = bestOf(5, [&]()
+        {
+            for(int r = 0; r < repeats; ++r)
+            {
+                for(int i = 0; i < num_samples; ++i)
+                {
+                    vec2 p = pointOnCurve(c, t[i]);
+                    x[i] = p.x;
+                    y[i] = p.y;
+                }
+            }
+        });
+
+        double batch_ms = bestOf(5, [&]()
+        {
+            for(int r = 0; r < repeats; ++r)
+            {
+                pointsOnCurve(c, t.data(), num_samples, x.data(), y.data());
+            }
+        });
+
+        float max_error = 0.0f;
+        for(int i = 0; i < num_samples; ++i)
+        {
+            max_error = std::max(max_error, distance(vec2(x[i], y[i]), pointOnCurve(c, t[i])));
+        }
+
+        printf("  %-26s single %7.2f ms   batch %6.2f ms   %5.1fx   max error %g px\n",
+               spline_type_names[type], single_ms, batch_ms, single_ms / batch_ms, max_error);
+    }
+}
+
+void benchClosestPoint()
+{
+    const int num_points = 100000;
+    const int num_queries = 100;
+
+    printf("closest point, brute force vs BVH, %d points, %d queries\n", num_points, num_queries);
+
+    for(int type = 0; type < SPLINE_TYPE_COUNT; ++type)
+    {
+        // A long wiggly path rather than noise, like a real one
+        Curve c;
+        setType(c, (SplineType)type);
+        vec2 p(0, 0);
+        for(int i = 0; i < num_points; ++i)
+        {
+            p += vec2((rand() / (float)RAND_MAX) * 20.0f - 8.0f, (rand() / (float)RAND_MAX) * 20.0f - 10.0f);
+            addPoint(c, p);
+        }
+        updateCoefficients(c);
+
+        CurveBVH bvh;
+        double build_ms = bestOf(1, [&]() { updateCurveBVH(bvh, c); });
+
+        std::vector<vec2> queries(num_queries);
+        for(vec2& q : queries)
+        {
+            q = c.points[rand() % num_points] + vec2((rand() / (float)RAND_MAX) * 100.0f - 50.0f, (rand() / (float)RAND_MAX) * 100.0f - 50.0f);
+        }
+
+        std::vector<float> brute(num_queries), fast(num_queries);
+        const int segments = segmentCount(c);
+
+        double brute_ms = bestOf(1, [&]()
+        {
+            for(int q = 0; q < num_queries; ++q)
+            {
+                float best = std::numeric_limits<float>::max();
+                for(int s = 0; s < segments; ++s)
+                {
+                    vec2 coef[4];
+                    cachedCoefficients(c, s, coef);
+                    float d;
+                    closestOnSegment(coef, queries[q], d);
+                    best = std::min(best, d);
+                }
+                brute[q] = std::sqrt(best);
+            }
+        });
+
+        double bvh_ms = bestOf(5, [&]()
+        {
+            for(int q = 0; q < num_queries; ++q)
+            {
+                fast[q] = closestPointOnCurve(bvh, c, queries[q]).distance;
+            }
+        });
+
+        // Move a point and refit, which is what happens while dragging
+        double refit_ms = bestOf(5, [&]()
+        {
+            movePoint(c, rand() % num_points, vec2(1, 1));
+            updateCoefficients(c);
+            updateCurveBVH(bvh, c);
+        });
+
+        float max_error = 0.0f;
+        for(int q = 0; q < num_queries; ++q)
+        {
+            max_error = std::max(max_error, std::fabs(brute[q] - fast[q]));
+        }
+
+        printf("  %-26s brute %8.1f ms   bvh %6.2f ms   %6.0fx   build %5.2f ms   refit %5.3f ms   max error %g px\n",
+               spline_type_names[type], brute_ms, bvh_ms, brute_ms / bvh_ms, build_ms, refit_ms, max_error);
+    }
+}
+
+void benchAgents()
+{
+    const int num_agents = 100000;
+    const int max_threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    Curve c = randomCurve(SPLINE_CATMULL_ROM, 1000);
+    updateArcLengths(c);
+    updateCoefficients(c);
+
+    Agents agents;
+    addAgents(agents, 0, curveLength(c), num_agents, 50.0f, 200.0f);
+
+    printf("updateAgents(), %d agents, 60 Hz is 16.7 ms\n", num_agents);
+
+    for(int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        double ms = bestOf(20, [&]() { updateAgents(agents, &c, 1.0f / 60.0f, threads); });
+        printf("  %2d thread(s) %6.2f ms\n", threads, ms);
+    }
+}
+
+void benchPathFile()
+{
+    const int num_points = 10000000;
+    const char* filename = "bench_path.spth";
+
+    Curve c = randomCurve(SPLINE_CATMULL_ROM, num_points);
+    updateArcLengths(c);
+
+    printf("path files, %d points\n", num_points);
+
+    double save_ms = bestOf(1, [&]() { savePath(c, filename, true); });
+
+    // Second run onwards the file is in the page cache, which is the usual case
+    // when reopening something you just saved
+    MappedPath m;
+    const char* error = "";
+    double map_ms = bestOf(5, [&]() { mapPath(filename, m, &error); unmapPath(m); });
+
+    Curve loaded;
+    double load_ms = bestOf(5, [&]() { loadPath(loaded, filename, &error); });
+
+    bool same = loaded.points.size() == c.points.size() &&
+                memcmp(loaded.points.data(), c.points.data(), c.points.size() * sizeof(vec2)) == 0 &&
+                loaded.lengths_version == loaded.version;
+
+    printf("  save %7.2f ms   map %6.3f ms   load %6.2f ms   round trip %s\n",
+           save_ms, map_ms, load_ms, same ? "ok" : "MISMATCH");
+
+    remove(filename);
+}
+
+void benchPointBatches()
+{
+    // Small enough to stay in cache, so this measures the arithmetic rather
+    // than memory bandwidth, which is all a big array would show
+    const int num_points = 16384;
+    const int repeats = 100;
+
+    std::vector<vec2> a(num_points), b(num_points), out(num_points);
+    std::vector<float> d(num_points);
+    for(int i = 0; i < num_points; ++i)
+    {
+        a[i] = vec2(rand() % 1000, rand() % 1000);
+        b[i] = vec2(rand() % 1000, rand() % 1000);
+    }
+
+    printf("vec2 arrays, %d points x %d, scalar loops vs vec2_batch.h\n", num_points, repeats);
+
+    auto report = [](const char* name, double scalar_ms, double batch_ms)
+    {
+        printf("  %-10s scalar %6.3f ms   batch %6.3f ms   %5.2fx\n", name, scalar_ms, batch_ms, scalar_ms / batch_ms);
+    };
+
+    auto run = [&](std::function<void()> f) { return bestOf(10, [&]() { for(int r = 0; r < repeats; ++r) f(); }); };
+
+    report("translate",
+           run([&]() { translatePointsScalar(a.data(), out.data(), num_points, vec2(3.0f, 4.0f)); }),
+           run([&]() { translatePoints(a.data(), out.data(), num_points, vec2(3.0f, 4.0f)); }));
+    report("lerp",
+           run([&]() { lerpPointsScalar(a.data(), b.data(), out.data(), num_points, 0.25f); }),
+           run([&]() { lerpPoints(a.data(), b.data(), out.data(), num_points, 0.25f); }));
+    report("distances",
+           run([&]() { distancesScalar(a.data(), b.data(), d.data(), num_points); }),
+           run([&]() { distances(a.data(), b.data(), d.data(), num_points); }));
+}
+
+void benchReparam()
+{
+    const int num_points = 1000;
+    const int num_lookups = 100000;
+
+    Curve c = randomCurve(SPLINE_CATMULL_ROM, num_points);
+    updateArcLengths(c);
+    updateCoefficients(c);
+
+    printf("reparameterization, %d points, %d lookups\n", num_points, num_lookups);
+
+    Reparam r;
+    double build_ms = bestOf(1, [&]() { updateReparam(r, c); });
+
+    // One point dragged, as in the editor. The curve's own tables have to be
+    // brought up to date first, so that's timed apart from the cache
+    double refit_ms = 1e9, cache_ms = 1e9;
+    for(int run = 0; run < 5; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        movePoint(c, num_points / 2, vec2(1.0f, 0.0f));
+        updateArcLengths(c);
+        updateCoefficients(c);
+        auto mid = std::chrono::steady_clock::now();
+        updateReparam(r, c);
+        auto end = std::chrono::steady_clock::now();
+        refit_ms = std::min(refit_ms, std::chrono::duration<double, std::milli>(end - start).count());
+        cache_ms = std::min(cache_ms, std::chrono::duration<double, std::milli>(end - mid).count());
+    }
+
+    std::vector<float> s(num_lookups);
+    for(int i = 0; i < num_lookups; ++i)
+    {
+        s[i] = (rand() / (float)RAND_MAX) * curveLength(c);
+    }
+
+    // Just finding t, which both ways below have to do
+    volatile float sink = 0.0f;
+    double search_ms = bestOf(5, [&]()
+    {
+        for(int i = 0; i < num_lookups; ++i)
+        {
+            sink += tAtDistance(c, s[i]);
+        }
+    });
+
+    // Without the cache: distance to t, then derivatives from the control points
+    double direct_ms = bestOf(5, [&]()
+    {
+        for(int i = 0; i < num_lookups; ++i)
+        {
+            float t = tAtDistance(c, s[i]);
+            int seg = std::min((int)t, segmentCount(c) - 1);
+            float u = t - seg;
+
+            vec2 coef[4];
+            segmentCoefficients(c, seg, coef);
+            vec2 v = coef[1] + (coef[2] * 2.0f + coef[3] * (3.0f * u)) * u;
+            vec2 a = coef[2] * 2.0f + coef[3] * (6.0f * u);
+            float speed = v.length();
+
+            sink += v.normalized().x + (v.x * a.y - v.y * a.x) / (speed * speed * speed);
+        }
+    });
+
+    double cached_ms = bestOf(5, [&]()
+    {
+        for(int i = 0; i < num_lookups; ++i)
+        {
+            CurveFrame f = frameAtDistance(r, c, s[i]);
+            sink += f.tangent.x + f.curvature;
+        }
+    });
+
+    printf("  build %6.3f ms   one point moved %6.3f ms, %6.3f ms of it the cache\n", build_ms, refit_ms, cache_ms);
+    printf("  search only %6.2f ms   direct %6.2f ms   cached %6.2f ms   %5.2fx, %5.2fx past the search\n",
+           search_ms, direct_ms, cached_ms, direct_ms / cached_ms,
+           (direct_ms - search_ms) / (cached_ms - search_ms));
+}
+
+int main()
+{
+    benchBatchEvaluation();
+    benchClosestPoint();
+    benchAgents();
+    benchPathFile();
+    benchPointBatches();
+    benchReparam();
+    return 0;
+}
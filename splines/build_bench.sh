@@ -0,0 +1 @@
+time c++ bench.cpp -O3 -march=native -std=c++11 -Wall -pthread -o bench
\ No newline at end of file
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "vec2.h"
+#include "spline.h"
+
+//
+// A curve through a list of control points, plus the data we cache about it
+//
+// Always change the points through addPoint() / movePoint() / clearPoints() so
+// the caches know when they need rebuilding. As well as the version of the
+// whole curve, each segment remembers the version it last changed at, so the
+// caches that are kept per segment only redo the segments that were edited.
+//
+// `t` runs from 0 at the start of the first segment to 1 at the start of the
+// second segment and so on, so t is in [0, segmentCount()]. For most types a
+// curve with N points has N-1 segments. Distances along the curve are in pixels.
+//
+
+// Number of samples per segment in the arc length table
+const int ARC_LENGTH_SAMPLES = 16;
+
+struct Curve
+{
+    std::vector<vec2> points;
+    SplineType type = SPLINE_CATMULL_ROM;
+
+    // Bumped every time the points or type change
+    unsigned version = 0;
+
+    // The version each segment last changed at
+    std::vector<unsigned> segment_versions;
+
+    // lengths[i] is the distance along the curve at t = i / ARC_LENGTH_SAMPLES
+    std::vector<float> lengths;
+    unsigned lengths_version = ~0u;
+
+    // Each segment as a polynomial, 8 floats per segment laid out as
+    // c0.x c1.x c2.x c3.x c0.y c1.y c2.y c3.y, see segmentCoefficients()
+    std::vector<float> coefficients;
+    unsigned coefficients_version = ~0u;
+};
+
+inline int segmentCount(const Curve& c)
+{
+    switch(c.type)
+    {
+        case SPLINE_LINEAR:      return Spline<SPLINE_LINEAR>::segmentCount((int)c.points.size());
+        case SPLINE_CATMULL_ROM: return Spline<SPLINE_CATMULL_ROM>::segmentCount((int)c.points.size());
+        case SPLINE_BEZIER:      return Spline<SPLINE_BEZIER>::segmentCount((int)c.points.size());
+        case SPLINE_BSPLINE:     return Spline<SPLINE_BSPLINE>::segmentCount((int)c.points.size());
+        default:                 return 0;
+    }
+}
+
+inline void affectedSegments(const Curve& c, int point, int& first, int& last)
+{
+    switch(c.type)
+    {
+        case SPLINE_LINEAR:      Spline<SPLINE_LINEAR>::affectedSegments(point, first, last); break;
+        case SPLINE_CATMULL_ROM: Spline<SPLINE_CATMULL_ROM>::affectedSegments(point, first, last); break;
+        case SPLINE_BEZIER:      Spline<SPLINE_BEZIER>::affectedSegments(point, first, last); break;
+        case SPLINE_BSPLINE:     Spline<SPLINE_BSPLINE>::affectedSegments(point, first, last); break;
+        default:                 first = 0; last = -1; break;
+    }
+}
+
+// Call after changing control point `point`
+inline void markChanged(Curve& c, int point)
+{
+    c.version++;
+    c.segment_versions.resize(segmentCount(c), c.version);
+
+    int first, last;
+    affectedSegments(c, point, first, last);
+
+    first = std::max(first, 0);
+    last = std::min(last, (int)c.segment_versions.size() - 1);
+
+    for(int i = first; i <= last; ++i)
+    {
+        c.segment_versions[i] = c.version;
+    }
+}
+
+// Call after changing the whole curve
+inline void markAllChanged(Curve& c)
+{
+    c.version++;
+    c.segment_versions.assign(segmentCount(c), c.version);
+}
+
+inline void addPoint(Curve& c, vec2 p)
+{
+    c.points.push_back(p);
+    markChanged(c, (int)c.points.size() - 1);
+}
+
+inline void movePoint(Curve& c, int i, vec2 delta)
+{
+    c.points[i] += delta;
+    markChanged(c, i);
+}
+
+inline void clearPoints(Curve& c)
+{
+    c.points.clear();
+    c.points.shrink_to_fit();
+    markAllChanged(c);
+}
+
+inline void setType(Curve& c, SplineType type)
+{
+    c.type = type;
+    markAllChanged(c);
+}
+
+inline float maxT(const Curve& c)
+{
+    return (float)segmentCount(c);
+}
+
+inline vec2 pointOnCurve(const Curve& c, float t)
+{
+    switch(c.type)
+    {
+        case SPLINE_LINEAR:      return pointOnSpline<SPLINE_LINEAR>(c.points, t);
+        case SPLINE_CATMULL_ROM: return pointOnSpline<SPLINE_CATMULL_ROM>(c.points, t);
+        case SPLINE_BEZIER:      return pointOnSpline<SPLINE_BEZIER>(c.points, t);
+        case SPLINE_BSPLINE:     return pointOnSpline<SPLINE_BSPLINE>(c.points, t);
+        default:                 return vec2();
+    }
+}
+
+inline void segmentCoefficients(const Curve& c, int segment, vec2 coef[4])
+{
+    vec2 g[4];
+
+    switch(c.type)
+    {
+        case SPLINE_LINEAR:
+            Spline<SPLINE_LINEAR>::segmentPoints(c.points, segment, g);
+            segmentCoefficients<SPLINE_LINEAR>(g, coef);
+            break;
+        case SPLINE_CATMULL_ROM:
+            Spline<SPLINE_CATMULL_ROM>::segmentPoints(c.points, segment, g);
+            segmentCoefficients<SPLINE_CATMULL_ROM>(g, coef);
+            break;
+        case SPLINE_BEZIER:
+            Spline<SPLINE_BEZIER>::segmentPoints(c.points, segment, g);
+            segmentCoefficients<SPLINE_BEZIER>(g, coef);
+            break;
+        case SPLINE_BSPLINE:
+            Spline<SPLINE_BSPLINE>::segmentPoints(c.points, segment, g);
+            segmentCoefficients<SPLINE_BSPLINE>(g, coef);
+            break;
+        default:
+            coef[0] = coef[1] = coef[2] = coef[3] = vec2();
+            break;
+    }
+}
+
+// Rebuilds Curve::coefficients for the segments that changed since last time
+inline void updateCoefficients(Curve& c)
+{
+    if(c.coefficients_version == c.version)
+        return;
+
+    const unsigned built = c.coefficients_version;
+    c.coefficients_version = c.version;
+
+    const int segments = segmentCount(c);
+    c.coefficients.resize(segments * 8);
+
+    for(int i = 0; i < segments; ++i)
+    {
+        if(built != ~0u && c.segment_versions[i] <= built)
+            continue;
+
+        vec2 coef[4];
+        segmentCoefficients(c, i, coef);
+
+        float* out = &c.coefficients[i * 8];
+        for(int k = 0; k < 4; ++k)
+        {
+            out[k]     = coef[k].x;
+            out[k + 4] = coef[k].y;
+        }
+    }
+}
+
+// Reads segment `i` back out of Curve::coefficients, needs updateCoefficients()
+inline void cachedCoefficients(const Curve& c, int i, vec2 coef[4])
+{
+    const float* k = &c.coefficients[i * 8];
+    for(int j = 0; j < 4; ++j)
+    {
+        coef[j] = vec2(k[j], k[j + 4]);
+    }
+}
+
+//
+// Arc length
+//
+// Curve::lengths is the one table of distances along the curve, everything
+// that turns distances into t (agents, moveAlongCurve(), the reparam cache)
+// reads it. Each segment's samples are integrated with Simpson's rule on
+// |P'(u)|, which is a lot closer than chords for the same number of samples.
+//
+// Only the segments that changed since last time are integrated again, the
+// rest keep their distances from the old table and are just shifted along,
+// so it's fine to call updateArcLengths() every update. After that turning a
+// distance into a t is a binary search and a lerp.
+//
+
+// Distance from the start of the segment at each of its ARC_LENGTH_SAMPLES + 1 samples
+inline void segmentArcLengths(const vec2 coef[4], float* out)
+{
+    auto speed = [&](float u) { return (coef[1] + (coef[2] * 2.0f + coef[3] * (3.0f * u)) * u).length(); };
+
+    const float step = 1.0f / ARC_LENGTH_SAMPLES;
+    out[0] = 0.0f;
+
+    float prev = speed(0.0f);
+    for(int i = 1; i <= ARC_LENGTH_SAMPLES; ++i)
+    {
+        const float u = i * step;
+        float mid = speed(u - step * 0.5f);
+        float next = speed(u);
+        out[i] = out[i-1] + (prev + 4.0f * mid + next) * (step / 6.0f);
+        prev = next;
+    }
+}
+
+inline void updateArcLengths(Curve& c)
+{
+    if(c.lengths_version == c.version)
+        return;
+
+    const unsigned built = c.lengths_version;
+    c.lengths_version = c.version;
+
+    const int segments = c.points.size() < 2 ? 0 : segmentCount(c);
+    const int old_size = built != ~0u ? (int)c.lengths.size() : 0;
+    c.lengths.resize(segments * ARC_LENGTH_SAMPLES + 1);
+    c.lengths[0] = 0.0f;
+
+    // Written in place from the front, so the old start of each segment is
+    // read before the segment in front of it overwrites it
+    float old_start = old_size > 0 ? c.lengths[0] : 0.0f;
+    float local[ARC_LENGTH_SAMPLES + 1];
+
+    for(int i = 0; i < segments; ++i)
+    {
+        float* out = &c.lengths[i * ARC_LENGTH_SAMPLES];
+        const bool unchanged = c.segment_versions[i] <= built && (i + 1) * ARC_LENGTH_SAMPLES < old_size;
+
+        if(unchanged)
+        {
+            for(int k = 0; k <= ARC_LENGTH_SAMPLES; ++k) local[k] = out[k] - old_start;
+            local[0] = 0.0f;
+        }
+        else
+        {
+            vec2 coef[4];
+            segmentCoefficients(c, i, coef);
+            segmentArcLengths(coef, local);
+        }
+
+        old_start = (i + 1) * ARC_LENGTH_SAMPLES < old_size ? out[ARC_LENGTH_SAMPLES] : 0.0f;
+
+        const float start = out[0];
+        for(int k = 1; k <= ARC_LENGTH_SAMPLES; ++k) out[k] = start + local[k];
+    }
+}
+
+// Total length of the curve in pixels, needs updateArcLengths()
+inline float curveLength(const Curve& c)
+{
+    return c.lengths.empty() ? 0.0f : c.lengths.back();
+}
+
+// Distance along the curve at `t`, needs updateArcLengths()
+inline float distanceAtT(const Curve& c, float t)
+{
+    if(c.lengths.size() < 2)
+        return 0.0f;
+
+    float f = clamp(t * ARC_LENGTH_SAMPLES, 0.0f, (float)(c.lengths.size() - 1));
+    int i = std::min((int)f, (int)c.lengths.size() - 2);
+
+    return lerp(c.lengths[i], c.lengths[i+1], f - (float)i);
+}
+
+// The t that is `s` pixels along the curve, needs updateArcLengths()
+inline float tAtDistance(const Curve& c, float s)
+{
+    if(c.lengths.size() < 2)
+        return 0.0f;
+
+    s = clamp(s, 0.0f, c.lengths.back());
+
+    // Last segment starting at or before s, searching only the first sample
+    // of each
+    const int segments = std::max(1, ((int)c.lengths.size() - 1) / ARC_LENGTH_SAMPLES);
+    int lo = 0, hi = segments - 1;
+    while(lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if(c.lengths[mid * ARC_LENGTH_SAMPLES] <= s) lo = mid;
+        else hi = mid - 1;
+    }
+
+    // Then the samples inside it, there are only a handful so counting the
+    // ones behind s is branch free and beats carrying on with the search
+    const float* samples = &c.lengths[lo * ARC_LENGTH_SAMPLES];
+    int k = 0;
+    for(int j = 1; j < ARC_LENGTH_SAMPLES; ++j) k += samples[j] <= s;
+    int i = lo * ARC_LENGTH_SAMPLES + k;
+
+    float span = c.lengths[i+1] - c.lengths[i];
+    float f = span > 0.0f ? (s - c.lengths[i]) / span : 0.0f;
+
+    return (i + f) / (float)ARC_LENGTH_SAMPLES;
+}
+
+// Same as tAtDistance(), but starts looking at `hint`, a t close to the answer.
+// Something moving a few pixels a frame only ever steps a sample or two from
+// where it was, so this skips the binary search and its cache misses.
+inline float tAtDistanceNear(const Curve& c, float s, float hint)
+{
+    const int last = (int)c.lengths.size() - 2;
+    if(last < 0)
+        return 0.0f;
+
+    s = clamp(s, 0.0f, c.lengths.back());
+
+    int i = clamp((int)(hint * ARC_LENGTH_SAMPLES), 0, last);
+
+    // Give up and do the binary search if it's further than a few samples
+    const int max_steps = 8;
+    int steps = 0;
+    while(i < last && c.lengths[i+1] < s && steps++ < max_steps) i++;
+    while(i > 0 && c.lengths[i] > s && steps++ < max_steps) i--;
+
+    if(c.lengths[i] > s || (i < last && c.lengths[i+1] < s))
+        return tAtDistance(c, s);
+
+    float span = c.lengths[i+1] - c.lengths[i];
+    float f = span > 0.0f ? (s - c.lengths[i]) / span : 0.0f;
+
+    return (i + f) / (float)ARC_LENGTH_SAMPLES;
+}
+
+// Returns the t that is `pixelsToMove` further along the curve than `tStart`,
+// negative distances move backwards. Needs updateArcLengths()
+inline float moveAlongCurve(const Curve& c, float tStart, float pixelsToMove)
+{
+    return tAtDistance(c, distanceAtT(c, tStart) + pixelsToMove);
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "curve.h"
+
+//
+// Closest point on a curve
+//
+// A bounding volume hierarchy over the segments of a curve. Each leaf is the
+// box around a segment's Bezier control points (the curve can't leave their
+// hull), and each node is the box around its two children. A query walks the
+// tree nearest child first and skips any box further away than the best
+// point found so far, so only a few segments near the query are ever tested.
+//
+// Segments are consecutive along the curve, so the tree is a fixed, implicit
+// binary tree over the segment order, node i has children 2i and 2i+1 and the
+// leaves start at `leaf_count`. When points move only the changed leaves and
+// their ancestors are refit, the tree is only rebuilt when it runs out of leaves.
+//
+
+struct Box
+{
+    vec2 min, max;
+};
+
+inline Box emptyBox()
+{
+    const float big = std::numeric_limits<float>::max();
+    return { vec2(big, big), vec2(-big, -big) };
+}
+
+inline Box merge(const Box& a, const Box& b)
+{
+    return { vec2(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y)),
+             vec2(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y)) };
+}
+
+// Squared distance from `p` to the closest point in the box, 0 inside it
+inline float distanceSquared(const Box& b, vec2 p)
+{
+    float dx = std::max(std::max(b.min.x - p.x, p.x - b.max.x), 0.0f);
+    float dy = std::max(std::max(b.min.y - p.y, p.y - b.max.y), 0.0f);
+    return dx * dx + dy * dy;
+}
+
+struct CurveBVH
+{
+    int leaf_count = 0;          // Power of 2, at least the number of segments
+    std::vector<Box> nodes;      // 2 * leaf_count, nodes[0] is unused and nodes[1] is the root
+    std::vector<unsigned> versions;
+};
+
+struct CurveHit
+{
+    float t;
+    vec2 point;
+    float distance;
+};
+
+inline Box segmentBox(const Curve& c, int segment)
+{
+    vec2 coef[4], b[4];
+    cachedCoefficients(c, segment, coef);
+    bezierFromCoefficients(coef, b);
+
+    Box box = { b[0], b[0] };
+    for(int i = 1; i < 4; ++i)
+    {
+        box.min = vec2(std::min(box.min.x, b[i].x), std::min(box.min.y, b[i].y));
+        box.max = vec2(std::max(box.max.x, b[i].x), std::max(box.max.y, b[i].y));
+    }
+    return box;
+}
+
+// Brings the tree up to date with the curve, needs updateCoefficients()
+inline void updateCurveBVH(CurveBVH& bvh, const Curve& c)
+{
+    const int segments = (int)c.segment_versions.size();
+
+    if(segments > bvh.leaf_count)
+    {
+        // Out of room, start again with enough leaves
+        bvh.leaf_count = 1;
+        while(bvh.leaf_count < segments) bvh.leaf_count *= 2;
+
+        bvh.nodes.assign(bvh.leaf_count * 2, emptyBox());
+        bvh.versions.clear();
+    }
+
+    // Segments that were removed leave empty leaves behind
+    const int old_segments = (int)bvh.versions.size();
+    bvh.versions.resize(segments, ~0u);
+
+    for(int i = segments; i < old_segments; ++i)
+    {
+        bvh.nodes[bvh.leaf_count + i] = emptyBox();
+    }
+
+    std::vector<int> dirty;
+    for(int i = 0; i < std::max(segments, old_segments); ++i)
+    {
+        if(i >= segments || bvh.versions[i] != c.segment_versions[i])
+        {
+            if(i < segments)
+            {
+                bvh.nodes[bvh.leaf_count + i] = segmentBox(c, i);
+                bvh.versions[i] = c.segment_versions[i];
+            }
+            dirty.push_back((bvh.leaf_count + i) / 2);
+        }
+    }
+
+    // Refit the parents of everything that changed, a level at a time so
+    // shared ancestors are only done once
+    while(!dirty.empty())
+    {
+        std::vector<int> parents;
+        int last = -1;
+        for(int n : dirty)
+        {
+            // n is 0 when the root is itself a leaf
+            if(n == last || n < 1)
+                continue;
+
+            last = n;
+            bvh.nodes[n] = merge(bvh.nodes[n * 2], bvh.nodes[n * 2 + 1]);
+            parents.push_back(n / 2);
+        }
+        dirty.swap(parents);
+    }
+}
+
+// Closest point to `p` on one segment with polynomial `coef`, returns the u and
+// writes the squared distance. Starts from the best of a few samples then
+// polishes it with Newton's method on d/du |P(u) - p|^2 = 0.
+inline float closestOnSegment(const vec2 coef[4], vec2 p, float& dist_sq)
+{
+    auto eval = [&](float u) { return coef[0] + (coef[1] + (coef[2] + coef[3] * u) * u) * u; };
+
+    const int samples = 8;
+    float best_u = 0.0f;
+    dist_sq = eval(0.0f).distanceSquared(p);
+
+    for(int i = 1; i <= samples; ++i)
+    {
+        float u = i / (float)samples;
+        float d = eval(u).distanceSquared(p);
+        if(d < dist_sq)
+        {
+            dist_sq = d;
+            best_u = u;
+        }
+    }
+
+    float u = best_u;
+    for(int i = 0; i < 5; ++i)
+    {
+        vec2 diff = eval(u) - p;
+        vec2 d1 = coef[1] + (coef[2] * 2.0f + coef[3] * (3.0f * u)) * u;
+        vec2 d2 = coef[2] * 2.0f + coef[3] * (6.0f * u);
+
+        float f = diff.dot(d1);
+        float df = d1.dot(d1) + diff.dot(d2);
+        if(df <= 0.0f)
+            break;
+
+        u = clamp(u - f / df, 0.0f, 1.0f);
+    }
+
+    // Newton can wander off, only take its answer if it's an improvement
+    float d = eval(u).distanceSquared(p);
+    if(d < dist_sq)
+    {
+        dist_sq = d;
+        return u;
+    }
+    return best_u;
+}
+
+// Closest point on the whole curve to `p`, needs updateCurveBVH()
+inline CurveHit closestPointOnCurve(const CurveBVH& bvh, const Curve& c, vec2 p)
+{
+    if(c.points.size() < 2 || bvh.nodes.empty())
+    {
+        vec2 only = c.points.empty() ? vec2() : c.points[0];
+        return { 0.0f, only, distance(only, p) };
+    }
+
+    const int segments = (int)bvh.versions.size();
+
+    float best_dist_sq = std::numeric_limits<float>::max();
+    float best_t = 0.0f;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 1;
+
+    while(top > 0)
+    {
+        int n = stack[--top];
+
+        if(distanceSquared(bvh.nodes[n], p) >= best_dist_sq)
+            continue;
+
+        if(n >= bvh.leaf_count)
+        {
+            int segment = n - bvh.leaf_count;
+            if(segment >= segments)
+                continue;
+
+            vec2 coef[4];
+            cachedCoefficients(c, segment, coef);
+
+            float dist_sq;
+            float u = closestOnSegment(coef, p, dist_sq);
+            if(dist_sq < best_dist_sq)
+            {
+                best_dist_sq = dist_sq;
+                best_t = segment + u;
+            }
+            continue;
+        }
+
+        // Push the far child first so the near one is looked at next
+        int a = n * 2, b = n * 2 + 1;
+        if(distanceSquared(bvh.nodes[a], p) < distanceSquared(bvh.nodes[b], p))
+            std::swap(a, b);
+
+        stack[top++] = a;
+        stack[top++] = b;
+    }
+
+    vec2 coef[4];
+    int segment = std::min((int)best_t, segments - 1);
+    float u = best_t - segment;
+    cachedCoefficients(c, segment, coef);
+    vec2 point = coef[0] + (coef[1] + (coef[2] + coef[3] * u) * u) * u;
+
+    return { best_t, point, std::sqrt(best_dist_sq) };
+}
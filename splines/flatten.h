@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+#include "curve.h"
+
+//
+// Adaptive flattening
+//
+// To draw a curve it has to be turned into lines first. Rather than a fixed
+// number of lines per segment, each segment is split in half until every piece
+// is within `tolerance` pixels of a straight line, so gentle curves get a few
+// lines and tight corners get many.
+//
+// The polylines are cached per segment in a FlatCurve, and updateFlatCurve()
+// only redoes the segments whose version has changed (or all of them if the
+// tolerance changes). Dragging a point only re-flattens the handful of
+// segments that point controls, however long the curve is.
+//
+
+struct FlatCurve
+{
+    // One polyline per segment, each includes both of its end points
+    std::vector<std::vector<vec2>> polylines;
+    std::vector<unsigned> versions;
+    float tolerance = 0.0f;
+};
+
+// Squared distance from `p` to the segment from `a` to `a + chord`,
+// `len_sq` is chord.lengthSquared() and isn't 0
+inline float distanceSquaredToChord(vec2 p, vec2 a, vec2 chord, float len_sq)
+{
+    vec2 d = p - a;
+    float along = d.x * chord.x + d.y * chord.y;
+
+    // Past either end the nearest point is that end
+    if(along <= 0.0f)
+        return d.lengthSquared();
+    if(along >= len_sq)
+        return (d - chord).lengthSquared();
+
+    // Cross product is the distance from the chord times the chord length
+    float cross = d.x * chord.y - d.y * chord.x;
+    return cross * cross / len_sq;
+}
+
+// True if both handles are within `tolerance` of the chord from b[0] to b[3].
+// The curve stays inside the hull of its control points, so that's enough.
+// It has to be the chord itself and not the line through it, handles in line
+// but past the ends pull the curve out beyond them.
+inline bool isFlat(const vec2 b[4], float tolerance)
+{
+    vec2 chord = b[3] - b[0];
+    float len_sq = chord.lengthSquared();
+    float tol_sq = tolerance * tolerance;
+
+    if(len_sq < 1e-6f)
+    {
+        // Start and end are the same point, just check the handles are close
+        return b[1].distanceSquared(b[0]) <= tol_sq && b[2].distanceSquared(b[0]) <= tol_sq;
+    }
+
+    return distanceSquaredToChord(b[1], b[0], chord, len_sq) <= tol_sq &&
+           distanceSquaredToChord(b[2], b[0], chord, len_sq) <= tol_sq;
+}
+
+// Appends the flattened Bezier to `out`, not including its first point
+inline void flattenBezier(const vec2 b[4], float tolerance, std::vector<vec2>& out, int depth = 0)
+{
+    const int max_depth = 16;
+
+    if(depth >= max_depth || isFlat(b, tolerance))
+    {
+        out.push_back(b[3]);
+        return;
+    }
+
+    // de Casteljau split at the middle
+    vec2 ab = lerp(b[0], b[1], 0.5f);
+    vec2 bc = lerp(b[1], b[2], 0.5f);
+    vec2 cd = lerp(b[2], b[3], 0.5f);
+    vec2 abc = lerp(ab, bc, 0.5f);
+    vec2 bcd = lerp(bc, cd, 0.5f);
+    vec2 mid = lerp(abc, bcd, 0.5f);
+
+    vec2 left[4]  = { b[0], ab, abc, mid };
+    vec2 right[4] = { mid, bcd, cd, b[3] };
+
+    flattenBezier(left, tolerance, out, depth + 1);
+    flattenBezier(right, tolerance, out, depth + 1);
+}
+
+inline void flattenSegment(const Curve& c, int segment, float tolerance, std::vector<vec2>& out)
+{
+    vec2 coef[4], b[4];
+    segmentCoefficients(c, segment, coef);
+    bezierFromCoefficients(coef, b);
+
+    out.clear();
+    out.push_back(b[0]);
+    flattenBezier(b, tolerance, out);
+}
+
+// Brings the cached polylines up to date, returns how many segments were redone
+inline int updateFlatCurve(FlatCurve& flat, const Curve& c, float tolerance)
+{
+    const int segments = (int)c.segment_versions.size();
+
+    if(tolerance != flat.tolerance)
+    {
+        flat.tolerance = tolerance;
+        flat.versions.assign(segments, ~0u);
+    }
+
+    flat.polylines.resize(segments);
+    flat.versions.resize(segments, ~0u);
+
+    int redone = 0;
+    for(int i = 0; i < segments; ++i)
+    {
+        if(flat.versions[i] == c.segment_versions[i])
+            continue;
+
+        flattenSegment(c, i, tolerance, flat.polylines[i]);
+        flat.versions[i] = c.segment_versions[i];
+        redone++;
+    }
+
+    return redone;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiler.h"
+
+//
+// Frame pacing
+//
+// Waits for the next frame on the performance counter, not SDL_GetTicks().
+// SDL_Delay() only has millisecond granularity and usually oversleeps, so it's
+// used to get close to the deadline and the last bit is a spin. The deadline
+// advances by exactly one period each frame so small errors don't add up, but
+// if a frame runs long it starts again from now instead of rushing to catch up.
+//
+// The wait happens at the start of the frame, just before polling input, so
+// the input used for a frame is as fresh as possible. Latency is measured from
+// that poll to when SDL_GL_SwapWindow() returns, which is when the driver took
+// the frame rather than when it hit the screen, but it's good enough to see
+// what the settings do.
+//
+// With vsync on the swap already waits for the display, so the pacer is off
+// by default (target_hz 0) and only caps when asked to. Without vsync nothing
+// else would hold the loop back, so turning it off (or not getting it) sets a
+// cap of PACER_NO_VSYNC_HZ if there isn't one already. Turning vsync back on
+// takes that cap off again, unless it's been changed by hand since.
+//
+
+const float PACER_NO_VSYNC_HZ = 120.0f;
+
+struct FramePacer
+{
+    float target_hz = 0.0f;     // 0 doesn't wait at all
+    float spin_ms = 1.0f;       // Always spin at least this long before the deadline
+    bool vsync = false;
+    bool auto_cap = false;      // target_hz came from pacerSetVsync(), not the user
+
+    // How late SDL_Delay() wakes up, added to the spin
+    float oversleep_ms = 1.0f;
+
+    Uint64 frequency = 0;
+    Uint64 deadline = 0;
+    Uint64 input_time = 0;
+    Uint64 present_time = 0;
+
+    // Present to present time and input to present latency for the last
+    // PROFILE_HISTORY frames, `next` is the oldest
+    float frame_ms[PROFILE_HISTORY] = {};
+    float latency_ms[PROFILE_HISTORY] = {};
+    int next = 0;
+    int count = 0;
+};
+
+// Returns false if the driver won't change the swap interval
+inline bool pacerSetVsync(FramePacer& f, bool vsync)
+{
+    const bool changed = SDL_GL_SetSwapInterval(vsync ? 1 : 0) == 0;
+    if(changed)
+        f.vsync = vsync;
+
+    // Don't let the loop run flat out, but don't stack a cap on top of vsync
+    if(!f.vsync && f.target_hz <= 0.0f)
+    {
+        f.target_hz = PACER_NO_VSYNC_HZ;
+        f.auto_cap = true;
+    }
+    else if(f.vsync && f.auto_cap)
+    {
+        f.target_hz = 0.0f;
+        f.auto_cap = false;
+    }
+
+    return changed;
+}
+
+inline float pacerMs(const FramePacer& f, Uint64 ticks)
+{
+    return ticks * 1000.0f / (float)f.frequency;
+}
+
+// Follows late wakeups quickly and early ones slowly, but capped so one bad
+// wakeup (the OS was busy) doesn't turn every frame into a long spin
+inline void pacerTrackOversleep(FramePacer& f, float overslept)
+{
+    const float rate = overslept > f.oversleep_ms ? 0.25f : 0.02f;
+    f.oversleep_ms += (overslept - f.oversleep_ms) * rate;
+    f.oversleep_ms = std::min(std::max(f.oversleep_ms, 0.0f), 4.0f);
+}
+
+// Waits until it's time for the next frame, then marks the time input is read
+inline void pacerWait(FramePacer& f)
+{
+    if(f.frequency == 0)
+        f.frequency = SDL_GetPerformanceFrequency();
+
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if(f.target_hz > 0.0f)
+    {
+        const Uint64 period = (Uint64)(f.frequency / f.target_hz);
+
+        if(f.deadline == 0 || now > f.deadline + period)
+        {
+            // First frame, or a long one, don't try to make up the time
+            f.deadline = now;
+        }
+
+        // Sleep while there's comfortably more than the spin left
+        const float margin_ms = f.spin_ms + f.oversleep_ms;
+        if(now < f.deadline)
+        {
+            float remaining_ms = pacerMs(f, f.deadline - now);
+            if(remaining_ms > margin_ms)
+            {
+                Uint32 sleep_ms = (Uint32)(remaining_ms - margin_ms);
+                if(sleep_ms > 0)
+                {
+                    SDL_Delay(sleep_ms);
+
+                    Uint64 woke = SDL_GetPerformanceCounter();
+                    float overslept = pacerMs(f, woke - now) - sleep_ms;
+                    pacerTrackOversleep(f, overslept);
+                    now = woke;
+                }
+            }
+        }
+
+        while(now < f.deadline)
+        {
+            now = SDL_GetPerformanceCounter();
+        }
+
+        f.deadline += period;
+    }
+    else
+    {
+        f.deadline = 0;
+    }
+
+    f.input_time = now;
+}
+
+// Call straight after SDL_GL_SwapWindow()
+inline void pacerPresented(FramePacer& f)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // The first frame has nothing to measure from, leave it out of the stats
+    const Uint64 previous = f.present_time;
+    f.present_time = now;
+    if(previous == 0)
+        return;
+
+    f.frame_ms[f.next] = pacerMs(f, now - previous);
+    f.latency_ms[f.next] = pacerMs(f, now - f.input_time);
+
+    f.next = (f.next + 1) % PROFILE_HISTORY;
+    f.count = std::min(f.count + 1, PROFILE_HISTORY);
+}
+
+struct PacerStats
+{
+    float frame_avg, jitter, frame_max;     // jitter is the standard deviation of the frame time
+    float latency_avg, latency_p99;
+};
+
+inline PacerStats pacerStats(const FramePacer& f)
+{
+    if(f.count == 0)
+        return { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    float sum = 0.0f, max = 0.0f, latency_sum = 0.0f;
+    for(int i = 0; i < f.count; ++i)
+    {
+        sum += f.frame_ms[i];
+        max = std::max(max, f.frame_ms[i]);
+        latency_sum += f.latency_ms[i];
+    }
+    const float avg = sum / f.count;
+
+    float variance = 0.0f;
+    for(int i = 0; i < f.count; ++i)
+    {
+        float d = f.frame_ms[i] - avg;
+        variance += d * d;
+    }
+
+    float sorted[PROFILE_HISTORY];
+    std::copy(f.latency_ms, f.latency_ms + f.count, sorted);
+    int p99 = std::min((int)(f.count * 0.99f), f.count - 1);
+    std::nth_element(sorted, sorted + p99, sorted + f.count);
+
+    return { avg, std::sqrt(variance / f.count), max, latency_sum / f.count, sorted[p99] };
+}
@@ -2,12 +2,22 @@
 #include <GL/glew.h>
 
 #include <vector>
+#include <cfloat>
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_sdl.h"
 #include "imgui/imgui_impl_opengl3.h"
 
 #include "vec2.h"
+#include "curve.h"
+#include "flatten.h"
+#include "point_grid.h"
+#include "curve_bvh.h"
+#include "agents.h"
+#include "profiler.h"
+#include "path_file.h"
+#include "frame_pacer.h"
+#include "reparam.h"
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
 
@@ -88,15 +98,31 @@ void init_world();
 void update(Platform& p);
 void render(Platform& p);
 
-vec2 pointOnCurve(const std::vector<vec2>& points, float t);
-
 //
 // globals
 //
 
-std::vector<vec2> points;
+Curve curve;
+PointGrid point_grid;
+CurveBVH curve_bvh;
+FlatCurve flat_curve;
+Reparam reparam;
+float flatness = 0.25f; // pixels
+int flattened_segments = 0;
 float tStart = 0.0f;
-vec2 pStart;
+float moveSpeed = 0.0f; // pixels per second along the curve
+CurveFrame startFrame;
+bool snapToCurve = false;
+CurveHit snap;
+
+Profiler profiler;
+FramePacer pacer;
+
+Agents agents;
+int agentThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+char pathFilename[256] = "path.spth";
+char pathStatus[128] = "";
 
 int main(int argc, char* argv[])
 {
@@ -128,161 +154,195 @@ int main(int argc, char* argv[])
     bool done = false;
     while (!done)
     {
-        Uint32 ticks_start = SDL_GetTicks();
+        {
+            ProfileScope scope(profiler, PHASE_WAIT);
+            pacerWait(pacer);
+        }
 
         p.time.prev_time = p.time.time;
         p.time.time = SDL_GetPerformanceCounter();
         p.time.dt = (p.time.time - p.time.prev_time) / (float)p.time.frequency;
         p.time.accumulator += p.time.dt;
 
-        p.clear_frame_state();
-        p.clear_update_state();
-
-        // Poll and handle events (inputs, window resize, etc.)
-        // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
-        // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application.
-        // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application.
-        // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
         {
-            ImGui_ImplSDL2_ProcessEvent(&event);
-            if (event.type == SDL_QUIT)
+            ProfileScope scope(profiler, PHASE_EVENTS);
+
+            p.clear_frame_state();
+            p.clear_update_state();
+
+            // Poll and handle events (inputs, window resize, etc.)
+            // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
+            // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application.
+            // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application.
+            // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
+            SDL_Event event;
+            while (SDL_PollEvent(&event))
             {
-                done = true;
-            }
-            else if (event.type == SDL_WINDOWEVENT && event.window.windowID == SDL_GetWindowID(sdl_window))
-            { 
-                if(event.window.event == SDL_WINDOWEVENT_CLOSE)
+                ImGui_ImplSDL2_ProcessEvent(&event);
+                if (event.type == SDL_QUIT)
                 {
                     done = true;
                 }
-                else if(event.window.event == SDL_WINDOWEVENT_RESIZED)
-                {
-                    p.window.w = (float)event.window.data1;
-                    p.window.h = (float)event.window.data2;
+                else if (event.type == SDL_WINDOWEVENT && event.window.windowID == SDL_GetWindowID(sdl_window))
+                { 
+                    if(event.window.event == SDL_WINDOWEVENT_CLOSE)
+                    {
+                        done = true;
+                    }
+                    else if(event.window.event == SDL_WINDOWEVENT_RESIZED)
+                    {
+                        p.window.w = (float)event.window.data1;
+                        p.window.h = (float)event.window.data2;
+                    }
                 }
-            }
             
-            if( !io.WantCaptureKeyboard )
-            {
-                /*
-                if(event.type == SDL_KEYDOWN)
+                if( !io.WantCaptureKeyboard )
                 {
-                    if(event.key.keysym.scancode == SDL_SCANCODE_SPACE && event.key.repeat == 0)
+                    /*
+                    if(event.type == SDL_KEYDOWN)
                     {
-                        //p.input.fire_pressed = true;
+                        if(event.key.keysym.scancode == SDL_SCANCODE_SPACE && event.key.repeat == 0)
+                        {
+                            //p.input.fire_pressed = true;
+                        }
                     }
+                    //*/
                 }
-                //*/
-            }
 
-            if( !io.WantCaptureMouse )
-            {
-                if(event.type == SDL_MOUSEBUTTONDOWN)
+                if( !io.WantCaptureMouse )
                 {
-                    if(event.button.button == SDL_BUTTON_LEFT)
+                    if(event.type == SDL_MOUSEBUTTONDOWN)
                     {
-                        p.mouse.l_pressed = true;
-                        p.mouse.l_down = true;
+                        if(event.button.button == SDL_BUTTON_LEFT)
+                        {
+                            p.mouse.l_pressed = true;
+                            p.mouse.l_down = true;
+                        }
+                    }
+                    else if(event.type == SDL_MOUSEMOTION)
+                    {
+                        p.mouse.x = (float)event.motion.x;
+                        p.mouse.y = (float)event.motion.y;
+                        p.mouse.dx = (float)event.motion.xrel;
+                        p.mouse.dy = (float)event.motion.yrel;
+                    }
+                    else if(event.type == SDL_MOUSEBUTTONUP)
+                    {
+                        if(event.button.button == SDL_BUTTON_LEFT)
+                        {
+                            p.mouse.l_released = true;
+                            p.mouse.l_down = false;
+                        }
                     }
                 }
-                else if(event.type == SDL_MOUSEMOTION)
+            }
+
+            if( !io.WantCaptureKeyboard )
+            {
+                const Uint8* keys = SDL_GetKeyboardState(nullptr);
+
+                if(keys[SDL_SCANCODE_A] && !keys[SDL_SCANCODE_D])
                 {
-                    p.mouse.x = (float)event.motion.x;
-                    p.mouse.y = (float)event.motion.y;
-                    p.mouse.dx = (float)event.motion.xrel;
-                    p.mouse.dy = (float)event.motion.yrel;
+                    p.input.lr_axis = -1;
                 }
-                else if(event.type == SDL_MOUSEBUTTONUP)
+                else if(!keys[SDL_SCANCODE_A] && keys[SDL_SCANCODE_D])
                 {
-                    if(event.button.button == SDL_BUTTON_LEFT)
-                    {
-                        p.mouse.l_released = true;
-                        p.mouse.l_down = false;
-                    }
+                    p.input.lr_axis = 1;
                 }
-            }
-        }
 
-        if( !io.WantCaptureKeyboard )
-        {
-            const Uint8* keys = SDL_GetKeyboardState(nullptr);
+                if(keys[SDL_SCANCODE_S] && !keys[SDL_SCANCODE_W])
+                {
+                    p.input.fb_axis = -1;
+                }
+                else if(!keys[SDL_SCANCODE_S] && keys[SDL_SCANCODE_W])
+                {
+                    p.input.fb_axis = 1;
+                }
 
-            if(keys[SDL_SCANCODE_A] && !keys[SDL_SCANCODE_D])
-            {
-                p.input.lr_axis = -1;
-            }
-            else if(!keys[SDL_SCANCODE_A] && keys[SDL_SCANCODE_D])
-            {
-                p.input.lr_axis = 1;
-            }
+                if( p.input.fb_axis != 0.0f || p.input.lr_axis != 0.0f )
+                {
+                    //glm::vec2 normed = glm::normalize(glm::vec2(p.input.lr_axis, p.input.fb_axis));
+                    //p.input.lr_axis = normed.x;
+                    //p.input.fb_axis = normed.y;
+                }
 
-            if(keys[SDL_SCANCODE_S] && !keys[SDL_SCANCODE_W])
-            {
-                p.input.fb_axis = -1;
-            }
-            else if(!keys[SDL_SCANCODE_S] && keys[SDL_SCANCODE_W])
-            {
-                p.input.fb_axis = 1;
+                if( keys[SDL_SCANCODE_LEFT] && !keys[SDL_SCANCODE_RIGHT] )
+                {
+                    p.input.yaw_axis = -1;
+                }
+                else if( !keys[SDL_SCANCODE_LEFT] && keys[SDL_SCANCODE_RIGHT] )
+                {
+                    p.input.yaw_axis = 1;
+                }
             }
 
-            if( p.input.fb_axis != 0.0f || p.input.lr_axis != 0.0f )
+            if( !io.WantCaptureMouse )
             {
-                //glm::vec2 normed = glm::normalize(glm::vec2(p.input.lr_axis, p.input.fb_axis));
-                //p.input.lr_axis = normed.x;
-                //p.input.fb_axis = normed.y;
-            }
 
-            if( keys[SDL_SCANCODE_LEFT] && !keys[SDL_SCANCODE_RIGHT] )
-            {
-                p.input.yaw_axis = -1;
-            }
-            else if( !keys[SDL_SCANCODE_LEFT] && keys[SDL_SCANCODE_RIGHT] )
-            {
-                p.input.yaw_axis = 1;
             }
         }
 
-        if( !io.WantCaptureMouse )
-        {
-
-        }
-
         const int max_updates = 5;
         int num_updates = 0;
         while( p.time.accumulator >= p.time.fixed_dt && num_updates < max_updates )
         {
+            ProfileScope scope(profiler, PHASE_UPDATE);
             update(p);
             p.time.accumulator -= p.time.fixed_dt;
             num_updates++;
         }
 
-        // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplSDL2_NewFrame(sdl_window);
-        ImGui::NewFrame();
+        // Hitting the limit with time still left to simulate means we've fallen behind
+        bool updates_capped = num_updates == max_updates && p.time.accumulator >= p.time.fixed_dt;
 
-        if (show_demo_window)
         {
-            p.clear_update_state();
-            ImGui::ShowDemoWindow(&show_demo_window);
+            ProfileScope scope(profiler, PHASE_IMGUI);
+
+            // Start the Dear ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplSDL2_NewFrame(sdl_window);
+            ImGui::NewFrame();
+
+            if (show_demo_window)
+            {
+                p.clear_update_state();
+                ImGui::ShowDemoWindow(&show_demo_window);
+            }
         }
 
         {
+            ProfileScope scope(profiler, PHASE_IMGUI);
+
             ImGui::Begin("Debug");
 
             ImGui::Separator();
             
-            ImGui::Value("Num Points", (int)points.size());
+            ImGui::Value("Num Points", (int)curve.points.size());
             ImGui::SameLine();
             if( ImGui::Button("Clear") )
             {
-                points.clear();
-                points.shrink_to_fit();
+                clearPoints(curve);
+                gridClear(point_grid);
+            }
+
+            int type = curve.type;
+            if( ImGui::Combo("type", &type, spline_type_names, SPLINE_TYPE_COUNT) )
+            {
+                setType(curve, (SplineType)type);
+                tStart = std::min(tStart, maxT(curve));
             }
 
-            ImGui::SliderFloat("start t", &tStart, 0.0f, (float)points.size() - 1 );
+            ImGui::Value("Length", curveLength(curve));
+            ImGui::SliderFloat("flatness", &flatness, 0.05f, 5.0f, "%.2f px");
+            ImGui::Value("Segments flattened", flattened_segments);
+            ImGui::SliderFloat("start t", &tStart, 0.0f, maxT(curve) );
+            ImGui::SliderFloat("move speed", &moveSpeed, -500.0f, 500.0f );
+            ImGui::Text("distance %.1f, curvature %.4f", startFrame.s, startFrame.curvature);
+            ImGui::Checkbox("snap mouse to curve", &snapToCurve);
+            if( snapToCurve )
+            {
+                ImGui::Text("t %.3f, distance %.2f", snap.t, snap.distance);
+            }
             ImGui::SliderFloat("mouse dx", &p.mouse.dx, -10, 10);
             ImGui::SliderFloat("mouse dy", &p.mouse.dy, -10, 10);
             ImGui::Value("l pressed", p.mouse.l_pressed);
@@ -290,6 +350,119 @@ int main(int argc, char* argv[])
 
             ImGui::Separator();
 
+            if( ImGui::TreeNode("file") )
+            {
+                ImGui::InputText("filename", pathFilename, sizeof(pathFilename));
+                if( ImGui::Button("Save") )
+                {
+                    updateArcLengths(curve);
+                    if( savePath(curve, pathFilename, true) )
+                        snprintf(pathStatus, sizeof(pathStatus), "saved %d points", (int)curve.points.size());
+                    else
+                        snprintf(pathStatus, sizeof(pathStatus), "couldn't write %s", pathFilename);
+                }
+                ImGui::SameLine();
+                if( ImGui::Button("Load") )
+                {
+                    Uint64 start = SDL_GetPerformanceCounter();
+                    const char* error = "";
+                    if( loadPath(curve, pathFilename, &error) )
+                    {
+                        // Everything the next frame would otherwise redo, so the
+                        // time is until the curve can be used, not just the parse
+                        gridRebuild(point_grid, curve.points);
+                        updateArcLengths(curve);
+                        updateCoefficients(curve);
+                        updateCurveBVH(curve_bvh, curve);
+                        updateReparam(reparam, curve);
+                        updateFlatCurve(flat_curve, curve, flatness);
+
+                        float ms = (SDL_GetPerformanceCounter() - start) * 1000.0f / (float)SDL_GetPerformanceFrequency();
+                        snprintf(pathStatus, sizeof(pathStatus), "loaded %d points in %.2f ms", (int)curve.points.size(), ms);
+                        tStart = std::min(tStart, maxT(curve));
+                    }
+                    else
+                    {
+                        snprintf(pathStatus, sizeof(pathStatus), "couldn't load %s: %s", pathFilename, error);
+                    }
+                }
+                ImGui::TextUnformatted(pathStatus);
+                ImGui::TreePop();
+            }
+
+            if( ImGui::TreeNode("agents") )
+            {
+                ImGui::Value("Num Agents", agentCount(agents));
+                if( ImGui::Button("Add 10k") )
+                {
+                    addAgents(agents, 0, curveLength(curve), 10000, 50.0f, 200.0f);
+                }
+                ImGui::SameLine();
+                if( ImGui::Button("Add 100k") )
+                {
+                    addAgents(agents, 0, curveLength(curve), 100000, 50.0f, 200.0f);
+                }
+                ImGui::SameLine();
+                if( ImGui::Button("Clear##agents") )
+                {
+                    clearAgents(agents);
+                }
+                ImGui::SliderInt("threads", &agentThreads, 1, 32);
+
+                ImGui::TreePop();
+            }
+
+            ImGui::Separator();
+
+            if( ImGui::TreeNode("profiler") )
+            {
+                char overlay[64];
+
+                for( int i = 0; i < PHASE_COUNT; i++ )
+                {
+                    ProfileStats stats = profileStats(profiler, (ProfilePhase)i);
+                    snprintf(overlay, ARRAY_SIZE(overlay), "min %.2f avg %.2f p99 %.2f ms", stats.min, stats.avg, stats.p99);
+
+                    ImGui::PlotLines(profile_phase_names[i], profiler.ms[i], PROFILE_HISTORY, profiler.next, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+                }
+
+                snprintf(overlay, ARRAY_SIZE(overlay), "max %d, capped on %d frames", max_updates, profiler.capped_frames);
+                ImGui::PlotHistogram("updates", profiler.updates, PROFILE_HISTORY, profiler.next, overlay, 0.0f, (float)max_updates, ImVec2(0, 40));
+
+                ImGui::TreePop();
+            }
+
+            ImGui::Separator();
+
+            if( ImGui::TreeNode("frame pacing") )
+            {
+                bool vsync = pacer.vsync;
+                if( ImGui::Checkbox("vsync", &vsync) )
+                {
+                    pacerSetVsync(pacer, vsync);
+                }
+                if( ImGui::SliderFloat("target", &pacer.target_hz, 0.0f, 240.0f, pacer.target_hz > 0.0f ? "%.0f Hz" : "off") )
+                {
+                    // Set by hand, so it stays when vsync comes back on
+                    pacer.auto_cap = false;
+                }
+                ImGui::SliderFloat("spin", &pacer.spin_ms, 0.0f, 4.0f, "%.2f ms");
+                ImGui::Text("oversleep %.2f ms", pacer.oversleep_ms);
+
+                PacerStats stats = pacerStats(pacer);
+                char overlay[64];
+
+                snprintf(overlay, ARRAY_SIZE(overlay), "avg %.2f jitter %.3f max %.2f ms", stats.frame_avg, stats.jitter, stats.frame_max);
+                ImGui::PlotLines("frame", pacer.frame_ms, PROFILE_HISTORY, pacer.next, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+
+                snprintf(overlay, ARRAY_SIZE(overlay), "avg %.2f p99 %.2f ms", stats.latency_avg, stats.latency_p99);
+                ImGui::PlotLines("latency", pacer.latency_ms, PROFILE_HISTORY, pacer.next, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+
+                ImGui::TreePop();
+            }
+
+            ImGui::Separator();
+
             if( ImGui::TreeNode("imgui info") )
             {
                 ImGui::Checkbox("Show demo Window", &show_demo_window);
@@ -302,25 +475,33 @@ int main(int argc, char* argv[])
             ImGui::End();
         }
 
-        render(p);
+        {
+            ProfileScope scope(profiler, PHASE_RENDER);
+            render(p);
+        }
 
-        ImGui::Render();
+        {
+            ProfileScope scope(profiler, PHASE_IMGUI);
+            ImGui::Render();
+        }
+
+        {
+            ProfileScope scope(profiler, PHASE_IMGUI);
+
+            SDL_GL_MakeCurrent(sdl_window, sdl_gl_context);
+            glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
+            glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
-        // Cap the framerate so we don't eat all the CPU
-        Uint32 ticks_end = SDL_GetTicks();
-        Uint32 ticks_taken = ticks_end - ticks_start;
-        Uint32 ticks_cap = 10;
-        if( ticks_taken < ticks_cap )
         {
-            SDL_Delay(ticks_cap - ticks_taken);
+            ProfileScope scope(profiler, PHASE_PRESENT);
+            SDL_GL_SwapWindow(sdl_window);
         }
+        pacerPresented(pacer);
 
-        SDL_GL_MakeCurrent(sdl_window, sdl_gl_context);
-        glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
-        glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(sdl_window);
+        profileEndFrame(profiler, num_updates, updates_capped);
     }
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -354,7 +535,8 @@ bool init_sdl()
     SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
     sdl_window = SDL_CreateWindow("Splines", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, window_flags);
     sdl_gl_context = SDL_GL_CreateContext(sdl_window);
-    SDL_GL_SetSwapInterval(1); // Enable vsync
+    // Without vsync this caps the framerate instead, so we don't eat all the CPU
+    pacerSetVsync(pacer, true);
 
     return true;
 }
@@ -395,37 +577,6 @@ void init_world()
 {
 }
 
-vec2 pointOnCurve(const std::vector<vec2>& points, float t)
-{
-    t = clamp(t, 0.0f, ((float)points.size()) - 1.0f);
-
-    if(points.empty())
-        return vec2();
-
-    if(points.size() == 1)
-        return points[0];
-
-    if(points.size() == 2)
-    {
-        return lerp(points[0], points[1], t);
-    }
-
-    int i = std::floor(t);
-    i = clamp(i, 0, (int)points.size() - 1);
-
-    if(i + 1 == (int)points.size())
-        return points.back();
-
-    return lerp(points[i], points[i+1], t - (float)i);
-}
-
-vec2 moveAlongCurve(const std::vector<vec2>& points, float tStart, float pixelsToMove)
-{
-    vec2 start = pointOnCurve(points, tStart);
-
-    return start;
-}
-
 static int hovered_point = -1;
 static const float hover_distance = 10.0f;
 
@@ -436,54 +587,79 @@ void update(Platform& p)
         hovered_point = -1;
     }
 
-    for(size_t i = 0; i < points.size() && hovered_point == -1; ++i)
+    if(hovered_point == -1)
     {
-        vec2 m(p.mouse.x, p.mouse.y);
-
-        if(distance(m, points[i]) < hover_distance)
-        {
-            hovered_point = i;
-            break;
-        }
+        hovered_point = gridClosest(point_grid, curve.points, vec2(p.mouse.x, p.mouse.y), hover_distance);
     }
 
 	if(p.mouse.l_pressed)
     {
         if(hovered_point < 0)
     	{
-    		points.push_back({p.mouse.x, p.mouse.y});
+    		addPoint(curve, {p.mouse.x, p.mouse.y});
+            gridInsert(point_grid, (int)curve.points.size() - 1, curve.points.back());
     	}
     }
     else if(p.mouse.l_down && hovered_point >= 0)
     {
-            points[hovered_point] += vec2(p.mouse.dx, p.mouse.dy);
+            vec2 from = curve.points[hovered_point];
+            movePoint(curve, hovered_point, vec2(p.mouse.dx, p.mouse.dy));
+            gridMove(point_grid, hovered_point, from, curve.points[hovered_point]);
+    }
+
+    updateArcLengths(curve);
+    updateCoefficients(curve);
+    updateCurveBVH(curve_bvh, curve);
+    updateReparam(reparam, curve);
+
+    if(snapToCurve)
+    {
+        snap = closestPointOnCurve(curve_bvh, curve, vec2(p.mouse.x, p.mouse.y));
     }
 
-    pStart = pointOnCurve(points, tStart);
+    updateAgents(agents, &curve, p.time.fixed_dt, agentThreads);
+
+    // Constant speed in pixels, wrapping around at the ends
+    float s = distanceAtT(curve, tStart);
+    if(moveSpeed != 0.0f)
+    {
+        s += moveSpeed * p.time.fixed_dt;
+        float length = curveLength(curve);
+
+        if(s > length) s = 0.0f;
+        else if(s < 0.0f) s = length;
+    }
+
+    startFrame = frameAtDistance(reparam, curve, s);
+    if(moveSpeed != 0.0f)
+    {
+        tStart = startFrame.t;
+    }
 }
 
 void render(Platform& p)
 {
     ImDrawList* g = ImGui::GetBackgroundDrawList();
 
-    for( size_t i = 0; i < points.size(); i++)
+    for( size_t i = 0; i < curve.points.size(); i++)
     {
-        g->AddCircleFilled(points[i], 5, 0xffaaaaaa);
+        g->AddCircleFilled(curve.points[i], 5, 0xffaaaaaa);
 
         if(hovered_point == (int)i)
         {
-            g->AddCircle(points[i], hover_distance, 0xffffffff);
+            g->AddCircle(curve.points[i], hover_distance, 0xffffffff);
         }
     }
 
     char buf[32];
 
-    for( size_t i = 0; i + 1 < points.size(); i++)
+    // Control polygon
+    for( size_t i = 0; i + 1 < curve.points.size(); i++)
     {
-        const vec2& a = points[i];
-        const vec2& b = points[i+1];
+        const vec2& a = curve.points[i];
+        const vec2& b = curve.points[i+1];
 
-    	g->AddLine(a, b, 0xff2222aa);
+    	g->AddLine(a, b, 0xff444444);
 
         float dist = distance(a, b);
         vec2 mid = lerp(a, b, 0.5f);
@@ -493,7 +669,40 @@ void render(Platform& p)
         g->AddText(mid, 0xffaaaaaa, buf);
     }
 
-    g->AddCircleFilled(pStart, 5, 0xffffffff);
+    // The curve itself, only the segments that changed get flattened again
+    flattened_segments = updateFlatCurve(flat_curve, curve, flatness);
+
+    for( size_t i = 0; i < flat_curve.polylines.size(); i++)
+    {
+        const std::vector<vec2>& line = flat_curve.polylines[i];
+        g->AddPolyline((const ImVec2*)line.data(), (int)line.size(), 0xff2222aa, false, 2.0f);
+    }
+
+    g->AddCircleFilled(startFrame.point, 5, 0xffffffff);
+    g->AddLine(startFrame.point, startFrame.point + startFrame.tangent * 20.0f, 0xffffffff, 2.0f);
+
+    if(snapToCurve && !curve.points.empty())
+    {
+        g->AddCircle(snap.point, 6, 0xff22aa22, 0, 2.0f);
+    }
+
+    // Agents, written straight into the vertex buffer a quad each. Done in
+    // batches so each reservation fits in 16 bit indices
+    const int agents_per_batch = 16000;
+    const float half_size = 1.5f;
+
+    for( int start = 0; start < agentCount(agents); start += agents_per_batch)
+    {
+        int end = std::min(start + agents_per_batch, agentCount(agents));
+
+        g->PrimReserve((end - start) * 6, (end - start) * 4);
+        for( int i = start; i < end; i++)
+        {
+            float x = agents.x[i];
+            float y = agents.y[i];
+            g->PrimRect(ImVec2(x - half_size, y - half_size), ImVec2(x + half_size, y + half_size), 0xff33ccff);
+        }
+    }
 
 	/*
     glm::vec2 pos = { player.pos.x, player.pos.z };
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+// No mmap, mapPath() reads the file into memory instead
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "curve.h"
+
+//
+// Binary path files
+//
+// A fixed size header followed by the control points as packed floats, and
+// optionally the curve's arc length table. Everything is little endian, in the
+// same layout as in memory, so loading is mapping the file and pointing at it
+// with no parsing at all. The header is a multiple of 8 bytes so the arrays
+// after it stay aligned.
+//
+//     PathFileHeader
+//     float points[point_count][2]
+//     float lengths[length_count]      only if PATH_HAS_ARC_LENGTHS is set
+//
+
+const char PATH_FILE_MAGIC[4] = { 'S', 'P', 'T', 'H' };
+const uint32_t PATH_FILE_VERSION = 1;
+
+enum PathFileFlags
+{
+    PATH_HAS_ARC_LENGTHS = 1 << 0,
+};
+
+struct PathFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t type;                  // SplineType
+    uint32_t flags;                 // PathFileFlags
+    uint64_t point_count;
+    uint64_t length_count;
+    uint32_t arc_length_samples;    // ARC_LENGTH_SAMPLES the table was built with
+    uint32_t reserved;
+};
+
+static_assert(sizeof(PathFileHeader) == 40, "PathFileHeader must not have padding");
+static_assert(sizeof(vec2) == 2 * sizeof(float), "vec2 must be two packed floats");
+
+// A path file mapped into memory, the pointers point straight into the file
+struct MappedPath
+{
+    void* data = nullptr;
+    size_t size = 0;
+
+    const PathFileHeader* header = nullptr;
+    const vec2* points = nullptr;
+    const float* lengths = nullptr;     // nullptr if the file doesn't have them
+};
+
+inline void unmapPath(MappedPath& m)
+{
+    if(m.data)
+    {
+#if defined(_WIN32)
+        free(m.data);
+#else
+        munmap(m.data, m.size);
+#endif
+    }
+    m = MappedPath();
+}
+
+// Maps `filename` and checks it's a valid path file. On failure returns false
+// and writes why into `error`.
+inline bool mapPath(const char* filename, MappedPath& m, const char** error)
+{
+    unmapPath(m);
+
+#if defined(_WIN32)
+    FILE* file = fopen(filename, "rb");
+    if(!file) { *error = "couldn't open file"; return false; }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if(size < (long)sizeof(PathFileHeader))
+    {
+        fclose(file);
+        *error = size < 0 ? "couldn't read file" : "file too small";
+        return false;
+    }
+
+    m.size = (size_t)size;
+    m.data = malloc(m.size);
+    bool read_ok = m.data && fread(m.data, 1, m.size, file) == m.size;
+    fclose(file);
+
+    if(!read_ok) { *error = "couldn't read file"; unmapPath(m); return false; }
+#else
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) { *error = "couldn't open file"; return false; }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PathFileHeader))
+    {
+        close(fd);
+        *error = "file too small";
+        return false;
+    }
+
+    m.size = (size_t)st.st_size;
+    m.data = mmap(nullptr, m.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(m.data == MAP_FAILED)
+    {
+        m.data = nullptr;
+        *error = "mmap failed";
+        return false;
+    }
+#endif
+
+    if(m.size < sizeof(PathFileHeader)) { *error = "file too small"; unmapPath(m); return false; }
+
+    const PathFileHeader* h = (const PathFileHeader*)m.data;
+
+    if(memcmp(h->magic, PATH_FILE_MAGIC, 4) != 0) { *error = "not a path file"; unmapPath(m); return false; }
+    if(h->version != PATH_FILE_VERSION)           { *error = "unsupported version"; unmapPath(m); return false; }
+    if(h->type >= SPLINE_TYPE_COUNT)              { *error = "unknown spline type"; unmapPath(m); return false; }
+
+    uint64_t lengths = (h->flags & PATH_HAS_ARC_LENGTHS) ? h->length_count : 0;
+    uint64_t expected = sizeof(PathFileHeader) + h->point_count * sizeof(vec2) + lengths * sizeof(float);
+
+    if(h->point_count > m.size || lengths > m.size || expected > m.size)
+    {
+        *error = "file is truncated";
+        unmapPath(m);
+        return false;
+    }
+
+    m.header = h;
+    m.points = (const vec2*)((const char*)m.data + sizeof(PathFileHeader));
+    m.lengths = lengths ? (const float*)(m.points + h->point_count) : nullptr;
+
+    return true;
+}
+
+// Writes the curve out, with its arc length table if `with_lengths` is set
+// (call updateArcLengths() first)
+inline bool savePath(const Curve& c, const char* filename, bool with_lengths)
+{
+    FILE* file = fopen(filename, "wb");
+    if(!file)
+        return false;
+
+    with_lengths = with_lengths && !c.lengths.empty();
+
+    PathFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PATH_FILE_MAGIC, 4);
+    h.version = PATH_FILE_VERSION;
+    h.type = (uint32_t)c.type;
+    h.flags = with_lengths ? PATH_HAS_ARC_LENGTHS : 0;
+    h.point_count = c.points.size();
+    h.length_count = with_lengths ? c.lengths.size() : 0;
+    h.arc_length_samples = ARC_LENGTH_SAMPLES;
+
+    bool ok = fwrite(&h, sizeof(h), 1, file) == 1;
+    ok = ok && fwrite(c.points.data(), sizeof(vec2), c.points.size(), file) == c.points.size();
+    if(with_lengths)
+    {
+        ok = ok && fwrite(c.lengths.data(), sizeof(float), c.lengths.size(), file) == c.lengths.size();
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+// Replaces the curve with the contents of the file. The points are copied out
+// of the mapping in one go, and a stored arc length table is used as is if it
+// was built with the same number of samples we use.
+inline bool loadPath(Curve& c, const char* filename, const char** error)
+{
+    MappedPath m;
+    if(!mapPath(filename, m, error))
+        return false;
+
+    c.points.assign(m.points, m.points + m.header->point_count);
+    c.type = (SplineType)m.header->type;
+    markAllChanged(c);
+
+    if(m.lengths && m.header->arc_length_samples == ARC_LENGTH_SAMPLES &&
+       m.header->length_count == (uint64_t)segmentCount(c) * ARC_LENGTH_SAMPLES + 1)
+    {
+        c.lengths.assign(m.lengths, m.lengths + m.header->length_count);
+        c.lengths_version = c.version;
+    }
+
+    unmapPath(m);
+    return true;
+}
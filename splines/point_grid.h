@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "vec2.h"
+
+//
+// Uniform grid over the control points, for picking with the mouse
+//
+// Points are bucketed into square cells keyed by their cell coordinates, so
+// it's sparse and doesn't care how far the points get dragged. As long as the
+// cell size is at least the pick radius a query only looks at the 3x3 cells
+// around the mouse, however many points there are.
+//
+// The grid only stores indices, keep it in step with the points by calling
+// gridInsert() / gridMove() / gridClear() alongside addPoint() and friends.
+//
+
+struct PointGrid
+{
+    float cell_size = 32.0f;
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+};
+
+inline int gridCell(const PointGrid& g, float v)
+{
+    return (int)std::floor(v / g.cell_size);
+}
+
+inline uint64_t gridKey(int cx, int cy)
+{
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+inline void gridInsert(PointGrid& g, int index, vec2 p)
+{
+    g.cells[gridKey(gridCell(g, p.x), gridCell(g, p.y))].push_back(index);
+}
+
+inline void gridRemove(PointGrid& g, int index, vec2 p)
+{
+    auto it = g.cells.find(gridKey(gridCell(g, p.x), gridCell(g, p.y)));
+    if(it == g.cells.end())
+        return;
+
+    std::vector<int>& cell = it->second;
+    auto found = std::find(cell.begin(), cell.end(), index);
+    if(found != cell.end())
+    {
+        *found = cell.back();
+        cell.pop_back();
+    }
+
+    if(cell.empty())
+    {
+        g.cells.erase(it);
+    }
+}
+
+// Point `index` moved from `from` to `to`, only touches the grid if it changed cell
+inline void gridMove(PointGrid& g, int index, vec2 from, vec2 to)
+{
+    if(gridCell(g, from.x) == gridCell(g, to.x) && gridCell(g, from.y) == gridCell(g, to.y))
+        return;
+
+    gridRemove(g, index, from);
+    gridInsert(g, index, to);
+}
+
+inline void gridClear(PointGrid& g)
+{
+    g.cells.clear();
+}
+
+inline void gridRebuild(PointGrid& g, const std::vector<vec2>& points)
+{
+    gridClear(g);
+    for(size_t i = 0; i < points.size(); ++i)
+    {
+        gridInsert(g, (int)i, points[i]);
+    }
+}
+
+// Index of the closest point within `radius` of `p`, or -1 if there isn't one.
+// `radius` should be no bigger than the cell size.
+inline int gridClosest(const PointGrid& g, const std::vector<vec2>& points, vec2 p, float radius)
+{
+    const int cx = gridCell(g, p.x);
+    const int cy = gridCell(g, p.y);
+
+    int closest = -1;
+    float closest_dist_sq = radius * radius;
+
+    for(int y = cy - 1; y <= cy + 1; ++y)
+    {
+        for(int x = cx - 1; x <= cx + 1; ++x)
+        {
+            auto it = g.cells.find(gridKey(x, y));
+            if(it == g.cells.end())
+                continue;
+
+            for(int i : it->second)
+            {
+                float dist_sq = p.distanceSquared(points[i]);
+
+                // Ties go to the earlier point, like the old linear search
+                if(dist_sq < closest_dist_sq || (dist_sq == closest_dist_sq && i < closest))
+                {
+                    closest = i;
+                    closest_dist_sq = dist_sq;
+                }
+            }
+        }
+    }
+
+    return closest;
+}
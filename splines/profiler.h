@@ -0,0 +1,109 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+
+//
+// A tiny per-phase frame profiler
+//
+// Put a ProfileScope around each part of the frame, the time is added to that
+// phase for the current frame (so a phase can be timed in more than one
+// place). profileEndFrame() pushes the frame's times into a ring buffer of the
+// last PROFILE_HISTORY frames, which is what the Debug window plots.
+//
+
+enum ProfilePhase
+{
+    PHASE_EVENTS,
+    PHASE_UPDATE,
+    PHASE_RENDER,
+    PHASE_IMGUI,
+    PHASE_PRESENT,
+    PHASE_WAIT,
+    PHASE_COUNT
+};
+
+static const char* const profile_phase_names[PHASE_COUNT] = {
+    "events",
+    "update",
+    "render",
+    "imgui",
+    "present",
+    "wait"
+};
+
+const int PROFILE_HISTORY = 240;
+
+struct Profiler
+{
+    // Milliseconds per phase, and fixed updates, for the last PROFILE_HISTORY frames.
+    // `next` is the oldest entry and where the next frame goes.
+    float ms[PHASE_COUNT][PROFILE_HISTORY] = {};
+    float updates[PROFILE_HISTORY] = {};
+    int next = 0;
+    int count = 0;
+
+    // Frames where the fixed update loop hit its limit and dropped time
+    int capped_frames = 0;
+
+    // The frame being timed
+    float current_ms[PHASE_COUNT] = {};
+};
+
+struct ProfileScope
+{
+    Profiler& profiler;
+    ProfilePhase phase;
+    Uint64 start;
+
+    ProfileScope(Profiler& profiler, ProfilePhase phase)
+        : profiler(profiler), phase(phase), start(SDL_GetPerformanceCounter()) {}
+
+    ~ProfileScope()
+    {
+        Uint64 end = SDL_GetPerformanceCounter();
+        profiler.current_ms[phase] += (end - start) * 1000.0f / (float)SDL_GetPerformanceFrequency();
+    }
+};
+
+// `num_updates` is how many fixed updates ran this frame, `capped` is true if
+// it stopped because it hit the limit rather than running out of time to simulate
+inline void profileEndFrame(Profiler& p, int num_updates, bool capped)
+{
+    for(int i = 0; i < PHASE_COUNT; ++i)
+    {
+        p.ms[i][p.next] = p.current_ms[i];
+        p.current_ms[i] = 0.0f;
+    }
+
+    p.updates[p.next] = (float)num_updates;
+    if(capped) p.capped_frames++;
+
+    p.next = (p.next + 1) % PROFILE_HISTORY;
+    p.count = std::min(p.count + 1, PROFILE_HISTORY);
+}
+
+struct ProfileStats
+{
+    float min, avg, p99;
+};
+
+inline ProfileStats profileStats(const Profiler& p, ProfilePhase phase)
+{
+    if(p.count == 0)
+        return { 0.0f, 0.0f, 0.0f };
+
+    // The unfilled part of the buffer is all at the end until it wraps
+    float sorted[PROFILE_HISTORY];
+    std::copy(p.ms[phase], p.ms[phase] + p.count, sorted);
+
+    float sum = 0.0f;
+    for(int i = 0; i < p.count; ++i) sum += sorted[i];
+
+    int p99 = std::min((int)(p.count * 0.99f), p.count - 1);
+    std::nth_element(sorted, sorted + p99, sorted + p.count);
+    float p99_value = sorted[p99];
+
+    return { *std::min_element(sorted, sorted + p.count), sum / p.count, p99_value };
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "vec2.h"
+
+//
+// Spline evaluation
+//
+// Every spline type is a cubic per segment, written as
+//
+//     P(u) = [1 u u^2 u^3] * M * G        u in [0, 1]
+//
+// where M is a constant 4x4 basis matrix and G holds the 4 points that control
+// the segment. Each type is a specialization of Spline<> that knows its basis
+// and how to pick G for a given segment. Because the basis is constexpr the
+// weights fold down to a few multiply-adds per segment.
+//
+// The end segments of Catmull-Rom and B-splines are missing a neighbour, so we
+// reflect the end point to make one up. That way both types start and finish
+// exactly on the first and last points.
+//
+// affectedSegments() gives the range of segments that use a control point,
+// which is what needs rebuilding when it moves. It may run off either end.
+//
+
+enum SplineType
+{
+    SPLINE_LINEAR,
+    SPLINE_CATMULL_ROM,
+    SPLINE_BEZIER,
+    SPLINE_BSPLINE,
+    SPLINE_TYPE_COUNT
+};
+
+static const char* const spline_type_names[SPLINE_TYPE_COUNT] = {
+    "Linear",
+    "Catmull-Rom (centripetal)",
+    "Cubic Bezier",
+    "Uniform B-spline"
+};
+
+// Row i holds the coefficients of u^i
+struct Basis
+{
+    float m[4][4];
+};
+
+template<SplineType T>
+struct Spline;
+
+// Control point `i`, or a reflection of the end point if it's off either end
+inline vec2 controlPoint(const std::vector<vec2>& points, int i)
+{
+    const int n = (int)points.size();
+
+    if(i < 0)  return points[0] * 2.0f - points[std::min(1, n - 1)];
+    if(i >= n) return points[n-1] * 2.0f - points[std::max(n - 2, 0)];
+
+    return points[i];
+}
+
+template<>
+struct Spline<SPLINE_LINEAR>
+{
+    static constexpr Basis basis()
+    {
+        return {{
+            {  1,  0,  0,  0 },
+            { -1,  1,  0,  0 },
+            {  0,  0,  0,  0 },
+            {  0,  0,  0,  0 },
+        }};
+    }
+
+    static int segmentCount(int numPoints) { return std::max(numPoints - 1, 0); }
+
+    static void affectedSegments(int point, int& first, int& last) { first = point - 1; last = point; }
+
+    static void segmentPoints(const std::vector<vec2>& points, int segment, vec2 g[4])
+    {
+        g[0] = points[segment];
+        g[1] = points[segment + 1];
+        g[2] = g[3] = g[1];
+    }
+};
+
+// Centripetal Catmull-Rom doesn't have a fixed basis, the tangents depend on
+// the spacing of the points. So G is built in Hermite form (two end points
+// and two tangents), and the constant Hermite basis does the rest.
+template<>
+struct Spline<SPLINE_CATMULL_ROM>
+{
+    static constexpr Basis basis()
+    {
+        return {{
+            {  1,  0,  0,  0 },
+            {  0,  0,  1,  0 },
+            { -3,  3, -2, -1 },
+            {  2, -2,  1,  1 },
+        }};
+    }
+
+    static int segmentCount(int numPoints) { return std::max(numPoints - 1, 0); }
+
+    static void affectedSegments(int point, int& first, int& last) { first = point - 2; last = point + 1; }
+
+    static void segmentPoints(const std::vector<vec2>& points, int segment, vec2 g[4])
+    {
+        vec2 p0 = controlPoint(points, segment - 1);
+        vec2 p1 = controlPoint(points, segment);
+        vec2 p2 = controlPoint(points, segment + 1);
+        vec2 p3 = controlPoint(points, segment + 2);
+
+        // Knot spacing is the square root of the distance between points
+        auto knot = [](vec2 a, vec2 b)
+        {
+            float k = std::sqrt(distance(a, b));
+            return k < 1e-4f ? 1.0f : k;
+        };
+
+        float t01 = knot(p0, p1);
+        float t12 = knot(p1, p2);
+        float t23 = knot(p2, p3);
+
+        vec2 m1 = ((p1 - p0) / t01 - (p2 - p0) / (t01 + t12) + (p2 - p1) / t12) * t12;
+        vec2 m2 = ((p2 - p1) / t12 - (p3 - p1) / (t12 + t23) + (p3 - p2) / t23) * t12;
+
+        g[0] = p1;
+        g[1] = p2;
+        g[2] = m1;
+        g[3] = m2;
+    }
+};
+
+// Every 3rd point is on the curve, the two between are the handles
+template<>
+struct Spline<SPLINE_BEZIER>
+{
+    static constexpr Basis basis()
+    {
+        return {{
+            {  1,  0,  0,  0 },
+            { -3,  3,  0,  0 },
+            {  3, -6,  3,  0 },
+            { -1,  3, -3,  1 },
+        }};
+    }
+
+    // A partly finished last segment repeats the final point
+    static int segmentCount(int numPoints) { return std::max((numPoints + 1) / 3, 0); }
+
+    // Points on the curve are shared by the segments either side of them
+    static void affectedSegments(int point, int& first, int& last) { last = point / 3; first = point % 3 == 0 ? last - 1 : last; }
+
+    static void segmentPoints(const std::vector<vec2>& points, int segment, vec2 g[4])
+    {
+        const int last = (int)points.size() - 1;
+
+        for(int i = 0; i < 4; ++i)
+        {
+            g[i] = points[std::min(segment * 3 + i, last)];
+        }
+    }
+};
+
+template<>
+struct Spline<SPLINE_BSPLINE>
+{
+    static constexpr Basis basis()
+    {
+        return {{
+            {  1/6.0f,  4/6.0f,  1/6.0f,  0      },
+            { -3/6.0f,  0,       3/6.0f,  0      },
+            {  3/6.0f, -6/6.0f,  3/6.0f,  0      },
+            { -1/6.0f,  3/6.0f, -3/6.0f,  1/6.0f },
+        }};
+    }
+
+    static int segmentCount(int numPoints) { return std::max(numPoints - 1, 0); }
+
+    static void affectedSegments(int point, int& first, int& last) { first = point - 2; last = point + 1; }
+
+    static void segmentPoints(const std::vector<vec2>& points, int segment, vec2 g[4])
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            g[i] = controlPoint(points, segment - 1 + i);
+        }
+    }
+};
+
+// Point at `u` on a single segment controlled by `g`
+template<SplineType T>
+inline vec2 evaluateSegment(const vec2 g[4], float u)
+{
+    constexpr Basis M = Spline<T>::basis();
+
+    float w[4];
+    for(int j = 0; j < 4; ++j)
+    {
+        w[j] = M.m[0][j] + u * (M.m[1][j] + u * (M.m[2][j] + u * M.m[3][j]));
+    }
+
+    return g[0] * w[0] + g[1] * w[1] + g[2] * w[2] + g[3] * w[3];
+}
+
+// The segment as a polynomial, P(u) = c[0] + c[1] u + c[2] u^2 + c[3] u^3
+template<SplineType T>
+inline void segmentCoefficients(const vec2 g[4], vec2 c[4])
+{
+    constexpr Basis M = Spline<T>::basis();
+
+    for(int i = 0; i < 4; ++i)
+    {
+        c[i] = g[0] * M.m[i][0] + g[1] * M.m[i][1] + g[2] * M.m[i][2] + g[3] * M.m[i][3];
+    }
+}
+
+// A segment's polynomial as the 4 control points of a cubic Bezier, handy
+// because the curve always stays inside the hull of those points
+inline void bezierFromCoefficients(const vec2 coef[4], vec2 b[4])
+{
+    b[0] = coef[0];
+    b[1] = coef[0] + coef[1] / 3.0f;
+    b[2] = coef[0] + (coef[1] * 2.0f + coef[2]) / 3.0f;
+    b[3] = coef[0] + coef[1] + coef[2] + coef[3];
+}
+
+template<SplineType T>
+inline vec2 pointOnSpline(const std::vector<vec2>& points, float t)
+{
+    if(points.empty())
+        return vec2();
+
+    if(points.size() == 1)
+        return points[0];
+
+    const int segments = Spline<T>::segmentCount((int)points.size());
+
+    t = clamp(t, 0.0f, (float)segments);
+
+    int i = clamp((int)std::floor(t), 0, segments - 1);
+
+    vec2 g[4];
+    Spline<T>::segmentPoints(points, i, g);
+
+    return evaluateSegment<T>(g, t - (float)i);
+}
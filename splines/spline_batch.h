@@ -0,0 +1,192 @@
+#pragma once
+
+#include "curve.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//
+// Batch spline evaluation
+//
+// pointOnCurve() is fine for one point, but it clamps, floors, bounds checks
+// and rebuilds the segment from the control points on every call. When the
+// same curve is sampled thousands of times a frame, use pointsOnCurve() to do
+// them all in one go. It reads the cached polynomial for each segment and
+// evaluates 8 (AVX2) or 4 (SSE) samples at once, with a scalar loop for the
+// remainder and for other platforms.
+//
+// The output is struct-of-arrays, x and y go to separate buffers.
+// Call updateCoefficients() after the points change and before evaluating.
+//
+// Against pointOnCurve() it's around 15x for centripetal Catmull-Rom but only
+// 4-6x for the others, which are cheap to evaluate one at a time anyway. With
+// random t almost all of the time goes on fetching each lane's polynomial:
+// pulling the segment indices out of the vector and transposing the loaded
+// rows are both shuffles, and they all queue for the same port. The sums
+// themselves are about a fifth of it. Gathers were slower still.
+//
+
+// Scalar version, also used for the tail of the SIMD loops
+inline void pointsOnCurveScalar(const Curve& c, const float* t, int count, float* out_x, float* out_y)
+{
+    const int segments = (int)c.coefficients.size() / 8;
+    const float max_t = (float)segments;
+
+    for(int i = 0; i < count; ++i)
+    {
+        float tt = clamp(t[i], 0.0f, max_t);
+        int s = std::min((int)tt, segments - 1);
+        float u = tt - (float)s;
+
+        const float* k = &c.coefficients[s * 8];
+        out_x[i] = k[0] + u * (k[1] + u * (k[2] + u * k[3]));
+        out_y[i] = k[4] + u * (k[5] + u * (k[6] + u * k[7]));
+    }
+}
+
+#if defined(__AVX2__)
+
+inline __m256 madd8(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+// 4 floats from `lo` in the low half, 4 from `hi` in the high half
+inline __m256 load2x4(const float* lo, const float* hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+// 4x4 transpose within each 128 bit half
+inline void transpose8x4(__m256 r[4])
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t2 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+
+    r[0] = _mm256_shuffle_ps(t0, t1, 0x44);
+    r[1] = _mm256_shuffle_ps(t0, t1, 0xEE);
+    r[2] = _mm256_shuffle_ps(t2, t3, 0x44);
+    r[3] = _mm256_shuffle_ps(t2, t3, 0xEE);
+}
+
+inline int pointsOnCurveSimd(const Curve& c, const float* t, int count, float* out_x, float* out_y)
+{
+    const int segments = (int)c.coefficients.size() / 8;
+    const float* coef = c.coefficients.data();
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max_t = _mm256_set1_ps((float)segments);
+    const __m256 last_segment = _mm256_set1_ps((float)(segments - 1));
+
+    alignas(32) int base[8];
+
+    int i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 tt = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(t + i), zero), max_t);
+
+        // t is positive, so truncating is the same as floor
+        __m256 s = _mm256_min_ps(_mm256_round_ps(tt, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), last_segment);
+        __m256 u = _mm256_sub_ps(tt, s);
+
+        _mm256_store_si256((__m256i*)base, _mm256_slli_epi32(_mm256_cvttps_epi32(s), 3));
+
+        // Gathers are slow on a lot of CPUs, so instead load each lane's x and
+        // y polynomials (lanes i and i+4 share a register), then transpose so
+        // each register holds one coefficient for all 8 lanes
+        __m256 x[4], y[4];
+        for(int j = 0; j < 4; ++j)
+        {
+            x[j] = load2x4(coef + base[j], coef + base[j + 4]);
+            y[j] = load2x4(coef + base[j] + 4, coef + base[j + 4] + 4);
+        }
+        transpose8x4(x);
+        transpose8x4(y);
+
+        __m256 px = madd8(u, madd8(u, madd8(u, x[3], x[2]), x[1]), x[0]);
+        __m256 py = madd8(u, madd8(u, madd8(u, y[3], y[2]), y[1]), y[0]);
+
+        _mm256_storeu_ps(out_x + i, px);
+        _mm256_storeu_ps(out_y + i, py);
+    }
+
+    return i;
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+inline int pointsOnCurveSimd(const Curve& c, const float* t, int count, float* out_x, float* out_y)
+{
+    const int segments = (int)c.coefficients.size() / 8;
+    const float* coef = c.coefficients.data();
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max_t = _mm_set1_ps((float)segments);
+    const __m128 last_segment = _mm_set1_ps((float)(segments - 1));
+
+    alignas(16) int base[4];
+
+    int i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 tt = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(t + i), zero), max_t);
+
+        // t is positive, so truncating is the same as floor
+        __m128 s = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(tt)), last_segment);
+        __m128 u = _mm_sub_ps(tt, s);
+
+        _mm_store_si128((__m128i*)base, _mm_slli_epi32(_mm_cvttps_epi32(s), 3));
+
+        // Load each lane's x and y polynomials, then transpose so each
+        // register holds one coefficient for all 4 lanes
+        __m128 x0 = _mm_loadu_ps(coef + base[0]), y0 = _mm_loadu_ps(coef + base[0] + 4);
+        __m128 x1 = _mm_loadu_ps(coef + base[1]), y1 = _mm_loadu_ps(coef + base[1] + 4);
+        __m128 x2 = _mm_loadu_ps(coef + base[2]), y2 = _mm_loadu_ps(coef + base[2] + 4);
+        __m128 x3 = _mm_loadu_ps(coef + base[3]), y3 = _mm_loadu_ps(coef + base[3] + 4);
+        _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+        _MM_TRANSPOSE4_PS(y0, y1, y2, y3);
+
+        __m128 x = _mm_add_ps(_mm_mul_ps(u, _mm_add_ps(_mm_mul_ps(u, _mm_add_ps(_mm_mul_ps(u, x3), x2)), x1)), x0);
+        __m128 y = _mm_add_ps(_mm_mul_ps(u, _mm_add_ps(_mm_mul_ps(u, _mm_add_ps(_mm_mul_ps(u, y3), y2)), y1)), y0);
+
+        _mm_storeu_ps(out_x + i, x);
+        _mm_storeu_ps(out_y + i, y);
+    }
+
+    return i;
+}
+
+#else
+
+inline int pointsOnCurveSimd(const Curve&, const float*, int, float*, float*)
+{
+    return 0;
+}
+
+#endif
+
+// Evaluates the curve at `count` values of t, needs updateCoefficients()
+inline void pointsOnCurve(const Curve& c, const float* t, int count, float* out_x, float* out_y)
+{
+    // Nothing to interpolate with 0 or 1 points
+    if(c.coefficients.empty())
+    {
+        vec2 p = c.points.empty() ? vec2() : c.points[0];
+        for(int i = 0; i < count; ++i)
+        {
+            out_x[i] = p.x;
+            out_y[i] = p.y;
+        }
+        return;
+    }
+
+    int done = pointsOnCurveSimd(c, t, count, out_x, out_y);
+    pointsOnCurveScalar(c, t + done, count - done, out_x + done, out_y + done);
+}
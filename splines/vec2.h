@@ -2,34 +2,54 @@
 
 #include <cmath>
 
-struct vec2
+//
+// 2D vector, in float (vec2) or double (dvec2) precision. Float is plenty for
+// anything on screen, double is for building very long paths where float
+// positions start losing pixels. Operations over whole arrays are in
+// vec2_batch.h.
+//
+
+template<typename T>
+struct tvec2
 {
-    float x, y;
+    T x, y;
+
+    tvec2() : x(0), y(0) {}
+    tvec2( T x, T y ) : x(x), y(y) {}
+
+    template<typename U>
+    explicit tvec2( const tvec2<U>& v ) : x((T)v.x), y((T)v.y) {}
 
-    vec2() : x(0), y(0) {}
-    vec2( float x, float y ) : x(x), y(y) {}
+    inline T dot( const tvec2& rhs )                const { return x*rhs.x + y*rhs.y; }
 
-    inline float dot( const vec2& rhs )             const { return x*rhs.x + y*rhs.y; }
+    inline T lengthSquared()                        const { return x * x + y * y; }
+    inline T length()                               const { return std::sqrt( lengthSquared() ); }
+    inline T distanceSquared( const tvec2& rhs )    const { return (*this - rhs).lengthSquared(); }
+    inline T distance( const tvec2& rhs )           const { return (*this - rhs).length(); }
 
-    inline float lengthSquared()                    const { return x * x + y * y; }
-    inline float length()                           const { return std::sqrt( lengthSquared() ); }
-    inline float distanceSquared( const vec2& rhs ) const { return (*this - rhs).lengthSquared(); }
-    inline float distance( const vec2& rhs )        const { return (*this - rhs).length(); }
-    inline vec2  normalized()                       const { return *this / length(); }
+    // The zero vector has no direction, it stays zero rather than becoming NaN
+    inline tvec2 normalized() const
+    {
+        T len = length();
+        return len > T(0) ? *this / len : tvec2();
+    }
 
     // Result is an angle in radians between -PI and PI
-    inline float angle( const vec2& rhs ) { return std::atan2(x*rhs.y-y*rhs.x, x*rhs.x+y*rhs.y); }
+    inline T angle( const tvec2& rhs ) const { return std::atan2(x*rhs.y-y*rhs.x, x*rhs.x+y*rhs.y); }
 
-    inline vec2& operator += ( const vec2& rhs ) { x += rhs.x; y += rhs.y; return *this; }
-    inline vec2& operator -= ( const vec2& rhs ) { x -= rhs.x; y -= rhs.y; return *this; }
+    inline tvec2& operator += ( const tvec2& rhs ) { x += rhs.x; y += rhs.y; return *this; }
+    inline tvec2& operator -= ( const tvec2& rhs ) { x -= rhs.x; y -= rhs.y; return *this; }
 
-    inline vec2 operator + ( const vec2& rhs ) const { return vec2( x + rhs.x, y + rhs.y ); }
-    inline vec2 operator - ( const vec2& rhs ) const { return vec2( x - rhs.x, y - rhs.y ); }
+    inline tvec2 operator + ( const tvec2& rhs ) const { return tvec2( x + rhs.x, y + rhs.y ); }
+    inline tvec2 operator - ( const tvec2& rhs ) const { return tvec2( x - rhs.x, y - rhs.y ); }
 
-    inline vec2 operator * ( float f ) const { return vec2( x*f, y*f ); }
-    inline vec2 operator / ( float f ) const { return vec2( x/f, y/f ); }
+    inline tvec2 operator * ( T f ) const { return tvec2( x*f, y*f ); }
+    inline tvec2 operator / ( T f ) const { return tvec2( x/f, y/f ); }
 };
 
+typedef tvec2<float> vec2;
+typedef tvec2<double> dvec2;
+
 template<typename T>
 inline T clamp(T val, T min, T max)
 {
@@ -42,7 +62,8 @@ inline T lerp(T a, T b, float t)
     return a + (b - a) * t;
 }
 
-inline float distance(vec2 a, vec2 b)
+template<typename T>
+inline T distance(tvec2<T> a, tvec2<T> b)
 {
     return a.distance(b);
-}
\ No newline at end of file
+}
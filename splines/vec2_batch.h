@@ -0,0 +1,229 @@
+#pragma once
+
+#include "vec2.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//
+// Operations over arrays of points
+//
+// Moving, scaling or blending a whole path one vec2 at a time leaves most of
+// the vector width unused. These work on the arrays directly. A vec2 array is
+// just x, y, x, y... so add, scale and lerp are the same operation on every
+// float, and each register holds 4 (AVX2) or 2 (SSE) points. Distances need
+// the x and y halves pulled apart first.
+//
+// Each function has a scalar template that works for vec2 and dvec2, the float
+// version does what it can with SIMD and finishes the remainder with that.
+// `out` may be the same array as an input.
+//
+
+template<typename T>
+inline void addPointsScalar(const tvec2<T>* a, const tvec2<T>* b, tvec2<T>* out, int count)
+{
+    for(int i = 0; i < count; ++i) out[i] = a[i] + b[i];
+}
+
+template<typename T>
+inline void translatePointsScalar(const tvec2<T>* in, tvec2<T>* out, int count, tvec2<T> offset)
+{
+    for(int i = 0; i < count; ++i) out[i] = in[i] + offset;
+}
+
+template<typename T>
+inline void scalePointsScalar(const tvec2<T>* in, tvec2<T>* out, int count, T scale)
+{
+    for(int i = 0; i < count; ++i) out[i] = in[i] * scale;
+}
+
+template<typename T>
+inline void lerpPointsScalar(const tvec2<T>* a, const tvec2<T>* b, tvec2<T>* out, int count, T t)
+{
+    for(int i = 0; i < count; ++i) out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+template<typename T>
+inline void distancesScalar(const tvec2<T>* a, const tvec2<T>* b, T* out, int count)
+{
+    for(int i = 0; i < count; ++i) out[i] = a[i].distance(b[i]);
+}
+
+// The SIMD versions return how many points they did, only float has them
+template<typename T> inline int addPointsSimd(const tvec2<T>*, const tvec2<T>*, tvec2<T>*, int) { return 0; }
+template<typename T> inline int translatePointsSimd(const tvec2<T>*, tvec2<T>*, int, tvec2<T>) { return 0; }
+template<typename T> inline int scalePointsSimd(const tvec2<T>*, tvec2<T>*, int, T) { return 0; }
+template<typename T> inline int lerpPointsSimd(const tvec2<T>*, const tvec2<T>*, tvec2<T>*, int, T) { return 0; }
+template<typename T> inline int distancesSimd(const tvec2<T>*, const tvec2<T>*, T*, int) { return 0; }
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+
+#if defined(__AVX2__)
+
+typedef __m256 vfloat;
+const int VFLOAT_WIDTH = 8;
+
+inline vfloat vload(const float* p)          { return _mm256_loadu_ps(p); }
+inline void   vstore(float* p, vfloat v)     { _mm256_storeu_ps(p, v); }
+inline vfloat vset(float f)                  { return _mm256_set1_ps(f); }
+inline vfloat vsetPair(float x, float y)     { return _mm256_setr_ps(x, y, x, y, x, y, x, y); }
+inline vfloat vadd(vfloat a, vfloat b)       { return _mm256_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b)       { return _mm256_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b)       { return _mm256_mul_ps(a, b); }
+
+// Two registers of x, y pairs to one register of x*x + y*y, in order
+inline vfloat vsumPairs(vfloat lo, vfloat hi)
+{
+    // Shuffles work within 128 bit halves, so this is p0 p1 p4 p5 | p2 p3 p6 p7
+    vfloat xs = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    vfloat ys = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    vfloat sum = _mm256_add_ps(xs, ys);
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+inline vfloat vsqrt(vfloat v) { return _mm256_sqrt_ps(v); }
+
+#else
+
+typedef __m128 vfloat;
+const int VFLOAT_WIDTH = 4;
+
+inline vfloat vload(const float* p)          { return _mm_loadu_ps(p); }
+inline void   vstore(float* p, vfloat v)     { _mm_storeu_ps(p, v); }
+inline vfloat vset(float f)                  { return _mm_set1_ps(f); }
+inline vfloat vsetPair(float x, float y)     { return _mm_setr_ps(x, y, x, y); }
+inline vfloat vadd(vfloat a, vfloat b)       { return _mm_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b)       { return _mm_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b)       { return _mm_mul_ps(a, b); }
+
+inline vfloat vsumPairs(vfloat lo, vfloat hi)
+{
+    vfloat xs = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    vfloat ys = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_ps(xs, ys);
+}
+
+inline vfloat vsqrt(vfloat v) { return _mm_sqrt_ps(v); }
+
+#endif
+
+// Points per register
+const int VFLOAT_POINTS = VFLOAT_WIDTH / 2;
+
+inline int addPointsSimd(const vec2* a, const vec2* b, vec2* out, int count)
+{
+    const float* fa = &a->x;
+    const float* fb = &b->x;
+    float* fo = &out->x;
+
+    int i = 0;
+    for(; i + VFLOAT_POINTS <= count; i += VFLOAT_POINTS)
+    {
+        vstore(fo + i * 2, vadd(vload(fa + i * 2), vload(fb + i * 2)));
+    }
+    return i;
+}
+
+inline int translatePointsSimd(const vec2* in, vec2* out, int count, vec2 offset)
+{
+    const float* fi = &in->x;
+    float* fo = &out->x;
+    const vfloat o = vsetPair(offset.x, offset.y);
+
+    int i = 0;
+    for(; i + VFLOAT_POINTS <= count; i += VFLOAT_POINTS)
+    {
+        vstore(fo + i * 2, vadd(vload(fi + i * 2), o));
+    }
+    return i;
+}
+
+inline int scalePointsSimd(const vec2* in, vec2* out, int count, float scale)
+{
+    const float* fi = &in->x;
+    float* fo = &out->x;
+    const vfloat s = vset(scale);
+
+    int i = 0;
+    for(; i + VFLOAT_POINTS <= count; i += VFLOAT_POINTS)
+    {
+        vstore(fo + i * 2, vmul(vload(fi + i * 2), s));
+    }
+    return i;
+}
+
+inline int lerpPointsSimd(const vec2* a, const vec2* b, vec2* out, int count, float t)
+{
+    const float* fa = &a->x;
+    const float* fb = &b->x;
+    float* fo = &out->x;
+    const vfloat vt = vset(t);
+
+    int i = 0;
+    for(; i + VFLOAT_POINTS <= count; i += VFLOAT_POINTS)
+    {
+        vfloat va = vload(fa + i * 2);
+        vfloat vb = vload(fb + i * 2);
+        vstore(fo + i * 2, vadd(va, vmul(vsub(vb, va), vt)));
+    }
+    return i;
+}
+
+// Two registers of points in, one register of distances out
+inline int distancesSimd(const vec2* a, const vec2* b, float* out, int count)
+{
+    const float* fa = &a->x;
+    const float* fb = &b->x;
+
+    int i = 0;
+    for(; i + VFLOAT_WIDTH <= count; i += VFLOAT_WIDTH)
+    {
+        vfloat d0 = vsub(vload(fa + i * 2), vload(fb + i * 2));
+        vfloat d1 = vsub(vload(fa + i * 2 + VFLOAT_WIDTH), vload(fb + i * 2 + VFLOAT_WIDTH));
+        vstore(out + i, vsqrt(vsumPairs(vmul(d0, d0), vmul(d1, d1))));
+    }
+    return i;
+}
+
+#endif
+
+// out[i] = a[i] + b[i]
+template<typename T>
+inline void addPoints(const tvec2<T>* a, const tvec2<T>* b, tvec2<T>* out, int count)
+{
+    int done = addPointsSimd(a, b, out, count);
+    addPointsScalar(a + done, b + done, out + done, count - done);
+}
+
+// out[i] = in[i] + offset
+template<typename T>
+inline void translatePoints(const tvec2<T>* in, tvec2<T>* out, int count, tvec2<T> offset)
+{
+    int done = translatePointsSimd(in, out, count, offset);
+    translatePointsScalar(in + done, out + done, count - done, offset);
+}
+
+// out[i] = in[i] * scale
+template<typename T>
+inline void scalePoints(const tvec2<T>* in, tvec2<T>* out, int count, T scale)
+{
+    int done = scalePointsSimd(in, out, count, scale);
+    scalePointsScalar(in + done, out + done, count - done, scale);
+}
+
+// out[i] = lerp(a[i], b[i], t)
+template<typename T>
+inline void lerpPoints(const tvec2<T>* a, const tvec2<T>* b, tvec2<T>* out, int count, T t)
+{
+    int done = lerpPointsSimd(a, b, out, count, t);
+    lerpPointsScalar(a + done, b + done, out + done, count - done, t);
+}
+
+// out[i] = distance(a[i], b[i])
+template<typename T>
+inline void distances(const tvec2<T>* a, const tvec2<T>* b, T* out, int count)
+{
+    int done = distancesSimd(a, b, out, count);
+    distancesScalar(a + done, b + done, out + done, count - done);
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "voronoi.h"
+
+//
+// Times the brute force kernel against the scanline one for each metric, and
+// checks they agree. Build with `build_bench.sh`, there's no SDL needed.
+//
+// Usage: ./bench [num_sites]
+//
+
+const int WIDTH = 800;
+const int HEIGHT = 600;
+
+double timeKernel( void (*kernel)( const std::vector<Point>&, int, int, std::vector<int>& ),
+                   const std::vector<Point>& sites, std::vector<int>& cells )
+{
+    // Best of a few runs, the first one also warms up the cells buffer
+    double best = 1e9;
+    for( int run = 0; run < 3; run++ )
+    {
+        auto start = std::chrono::steady_clock::now();
+        kernel( sites, WIDTH, HEIGHT, cells );
+        auto end = std::chrono::steady_clock::now();
+        best = std::min( best, std::chrono::duration<double, std::milli>( end - start ).count() );
+    }
+    return best;
+}
+
+template<typename Metric>
+void compare( const char* name, const std::vector<Point>& sites )
+{
+    std::vector<int> brute, scanline;
+
+    double brute_ms = timeKernel( nearestSites<Metric>, sites, brute );
+    double scanline_ms = timeKernel( nearestSitesScanline<Metric>, sites, scanline );
+
+    // Ties can legitimately pick different sites, so compare the distances
+    int mismatches = 0;
+    for( int y = 0; y < HEIGHT; y++ )
+    {
+        for( int x = 0; x < WIDTH; x++ )
+        {
+            int i = y * WIDTH + x;
+            if( Metric::distance( sites[brute[i]], (float)x, (float)y ) != Metric::distance( sites[scanline[i]], (float)x, (float)y ) )
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    printf( "%-10s brute force %8.2f ms   scanline %8.2f ms   %6.1fx   mismatches %d\n",
+            name, brute_ms, scanline_ms, brute_ms / scanline_ms, mismatches );
+}
+
+int main( int argc, char* argv[] )
+{
+    int num_sites = argc > 1 ? atoi( argv[1] ) : 100;
+
+    std::vector<Point> sites( num_sites );
+    for( Point& p : sites )
+    {
+        p.x = ( rand()/float(RAND_MAX) ) * WIDTH;
+        p.y = ( rand()/float(RAND_MAX) ) * HEIGHT;
+        p.weight = ( rand()/float(RAND_MAX) ) * 40.0f;
+        p.r = p.g = p.b = 0;
+    }
+
+    printf( "%d sites, %dx%d pixels\n", num_sites, WIDTH, HEIGHT );
+
+    compare<Euclidean>( "Euclidean", sites );
+    compare<Manhattan>( "Manhattan", sites );
+    compare<Chebyshev>( "Chebyshev", sites );
+    compare<Minkowski<3>>( "Minkowski3", sites );
+    compare<Power>( "Power", sites );
+
+    return 0;
+}
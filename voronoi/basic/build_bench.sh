@@ -0,0 +1 @@
+time c++ bench.cpp -O3 -std=c++11 -Wall -o bench
\ No newline at end of file
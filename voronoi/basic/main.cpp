@@ -1,31 +1,40 @@
 #include <SDL2/SDL.h>
 #include <iostream>
 #include <vector>
+#include <string>
 #include <algorithm>
 
+#include "voronoi.h"
+
 SDL_Window* win = NULL;
 SDL_Renderer* ren = NULL;
 const int WIDTH = 800;
 const int HEIGHT = 600;
 bool redraw = true;
 
-struct Point
+enum DistanceMetric
 {
-    Point() {}
-    ~Point() {}
-    float x, y;
-    Uint8 r, g, b;
+    METRIC_EUCLIDEAN,
+    METRIC_MANHATTAN,
+    METRIC_CHEBYSHEV,
+    METRIC_MINKOWSKI,
+    METRIC_POWER,
 };
 
+DistanceMetric metric = METRIC_EUCLIDEAN;
+
 std::vector<Point> points;
+std::vector<int> cells;
 
 void init();
+void generate();
 void draw();
 
 int main()
 {
     init();
-        
+    generate();
+
     SDL_Event event;
     bool done = false;
     while( !done )
@@ -35,13 +44,22 @@ int main()
             if( event.type == SDL_QUIT ) done = true;
             if( event.type == SDL_KEYDOWN )
             {
-                if( event.key.keysym.scancode == SDL_SCANCODE_ESCAPE )
+                SDL_Scancode key = event.key.keysym.scancode;
+
+                if( key == SDL_SCANCODE_ESCAPE )
                 {
                    done = true;
                 }
+                else if( key >= SDL_SCANCODE_1 && key <= SDL_SCANCODE_5 )
+                {
+                    // Number keys switch the metric but keep the same points
+                    metric = DistanceMetric( key - SDL_SCANCODE_1 );
+                    redraw = true;
+                }
                 else
                 {
-                redraw = true;
+                    generate();
+                    redraw = true;
                 }
             }
         }
@@ -68,62 +86,54 @@ void init()
     SDL_RenderPresent( ren );
 }
 
-void draw()
+void generate()
 {
-    SDL_SetRenderDrawColor( ren, 0, 0, 0, 0 );
-    SDL_RenderClear( ren );
-
     // Ensure the vector is empty
-    points.clear();    
+    points.clear();
 
     for( int i = 0; i < 100; i++ )
     {
         points.push_back(Point());
         points.back().x = ( rand()/float(RAND_MAX) ) * WIDTH;
         points.back().y = ( rand()/float(RAND_MAX) ) * HEIGHT;
+        points.back().weight = ( rand()/float(RAND_MAX) ) * 40.0f;
         points.back().r = rand() % 256;
         points.back().g = rand() % 256;
         points.back().b = rand() % 256;
     }
+}
+
+void draw()
+{
+    SDL_SetRenderDrawColor( ren, 0, 0, 0, 0 );
+    SDL_RenderClear( ren );
 
-    // For every pixel
     // Find the closest point to each pixel
+    // Picking the metric here means each one gets its own loop, rather than
+    // deciding which distance to use for every pixel and every point.
+    // See bench.cpp for how the scanline version compares to brute force
+    const char* name = "";
+    switch( metric )
+    {
+        case METRIC_EUCLIDEAN: nearestSitesScanline<Euclidean>( points, WIDTH, HEIGHT, cells ); name = Euclidean::name(); break;
+        case METRIC_MANHATTAN: nearestSitesScanline<Manhattan>( points, WIDTH, HEIGHT, cells ); name = Manhattan::name(); break;
+        case METRIC_CHEBYSHEV: nearestSitesScanline<Chebyshev>( points, WIDTH, HEIGHT, cells ); name = Chebyshev::name(); break;
+        case METRIC_MINKOWSKI: nearestSitesScanline<Minkowski<3>>( points, WIDTH, HEIGHT, cells ); name = Minkowski<3>::name(); break;
+        case METRIC_POWER:     nearestSitesScanline<Power>( points, WIDTH, HEIGHT, cells ); name = Power::name(); break;
+    }
+
+    std::string title = std::string( "Voronoi Basic - " ) + name;
+    SDL_SetWindowTitle( win, title.c_str() );
+
+    // For every pixel
     for( int y = 0; y < HEIGHT; y++ )
     {
         for( int x = 0; x < WIDTH; x++ )
         {
-            
-            // This version requires `-std=c++14`
-            // It's also really slow unless you enable optimisations with `-O3`
-            /*
-            const auto p = std::min_element( begin(points), end(points),
-                     [x, y](const auto& a, const auto& b)
-                     { return pow(a.x - x, 2) + pow(a.y - y, 2) < pow(b.x - x, 2) + pow(b.y - y, 2); } );
-
-            SDL_SetRenderDrawColor( ren, p->r, p->g, p->b, 255 );
-            SDL_RenderDrawPoint( ren, x, y );
-            //*/
-
-            //*
-            float dist_squared = WIDTH * WIDTH + HEIGHT * HEIGHT;
-            int closest_point = 0;
+            const Point& p = points[cells[y * WIDTH + x]];
 
-            for( int i = 0; i < points.size(); i++ )
-            {
-                float x_dist = points[i].x - x;
-                float y_dist = points[i].y - y;
-
-                if( x_dist * x_dist + y_dist * y_dist < dist_squared )
-                {
-                    closest_point = i;
-                    dist_squared = x_dist * x_dist + y_dist * y_dist;
-                }
-            }
-
-            SDL_SetRenderDrawColor( ren, points[closest_point].r, points[closest_point].g, points[closest_point].b, 255 );
+            SDL_SetRenderDrawColor( ren, p.r, p.g, p.b, 255 );
             SDL_RenderDrawPoint( ren, x, y );
-            //*/
-
         }
     }
 
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+struct Point
+{
+    Point() {}
+    ~Point() {}
+    float x, y;
+    float weight; // Only used by the power metric
+    uint8_t r, g, b;
+};
+
+//
+// Distance metrics
+//
+// Each metric is a policy with a static `distance()` used by the kernels below.
+// Only the ordering of distances matters for finding the closest site, so the
+// final sqrt (or p-th root) is skipped wherever it wouldn't change the order.
+//
+// Everything is written with fabs / max / multiplies so each instantiation of
+// the kernel ends up as its own branch free inner loop.
+//
+// `bound()` is the smallest distance a site could have given only the (positive)
+// x distance to it, the scanline kernel uses it to stop searching early.
+//
+
+struct Euclidean
+{
+    static const char* name() { return "Euclidean"; }
+
+    static inline float distance( const Point& p, float x, float y )
+    {
+        float dx = p.x - x;
+        float dy = p.y - y;
+        return dx * dx + dy * dy;
+    }
+
+    static inline float bound( float dx, float /*max_weight*/ ) { return dx * dx; }
+};
+
+struct Manhattan
+{
+    static const char* name() { return "Manhattan"; }
+
+    static inline float distance( const Point& p, float x, float y )
+    {
+        return std::fabs( p.x - x ) + std::fabs( p.y - y );
+    }
+
+    static inline float bound( float dx, float /*max_weight*/ ) { return dx; }
+};
+
+struct Chebyshev
+{
+    static const char* name() { return "Chebyshev"; }
+
+    static inline float distance( const Point& p, float x, float y )
+    {
+        return std::max( std::fabs( p.x - x ), std::fabs( p.y - y ) );
+    }
+
+    static inline float bound( float dx, float /*max_weight*/ ) { return dx; }
+};
+
+// x^N for a compile time N, unrolls into N-1 multiplies instead of calling pow()
+template<int N>
+inline float powN( float x ) { return x * powN<N - 1>( x ); }
+
+template<>
+inline float powN<1>( float x ) { return x; }
+
+// Minkowski distance of order P, P = 1 is Manhattan and P = 2 is Euclidean.
+// As P grows the cells get closer and closer to the Chebyshev ones.
+template<int P>
+struct Minkowski
+{
+    static_assert( P >= 1, "Minkowski order must be at least 1" );
+
+    static const char* name() { return "Minkowski"; }
+
+    static inline float distance( const Point& p, float x, float y )
+    {
+        return powN<P>( std::fabs( p.x - x ) ) + powN<P>( std::fabs( p.y - y ) );
+    }
+
+    static inline float bound( float dx, float /*max_weight*/ ) { return powN<P>( dx ); }
+};
+
+// Power (Laguerre) distance, the squared distance minus the squared weight.
+// Sites with a bigger weight claim more space, and the cell edges stay straight.
+struct Power
+{
+    static const char* name() { return "Power"; }
+
+    static inline float distance( const Point& p, float x, float y )
+    {
+        float dx = p.x - x;
+        float dy = p.y - y;
+        return dx * dx + dy * dy - p.weight * p.weight;
+    }
+
+    static inline float bound( float dx, float max_weight ) { return dx * dx - max_weight * max_weight; }
+};
+
+//
+// Kernels
+//
+
+// Index of the site closest to (x, y), `sites` must not be empty
+//
+// This could also be written with std::min_element, which requires `-std=c++14`
+// It's also really slow unless you enable optimisations with `-O3`
+/*
+    const auto p = std::min_element( begin(sites), end(sites),
+             [x, y](const auto& a, const auto& b)
+             { return Metric::distance(a, x, y) < Metric::distance(b, x, y); } );
+//*/
+template<typename Metric>
+inline int closestSite( const std::vector<Point>& sites, float x, float y )
+{
+    float closest_dist = std::numeric_limits<float>::max();
+    int closest = 0;
+
+    for( int i = 0; i < (int)sites.size(); i++ )
+    {
+        float dist = Metric::distance( sites[i], x, y );
+
+        // Selects rather than branches, so the compiler can keep this loop tight
+        bool closer = dist < closest_dist;
+        closest = closer ? i : closest;
+        closest_dist = closer ? dist : closest_dist;
+    }
+
+    return closest;
+}
+
+// Brute force, fills `cells` with the index of the closest site for every pixel
+template<typename Metric>
+void nearestSites( const std::vector<Point>& sites, int width, int height, std::vector<int>& cells )
+{
+    cells.resize( width * height );
+
+    if( sites.empty() )
+    {
+        std::fill( cells.begin(), cells.end(), -1 );
+        return;
+    }
+
+    for( int y = 0; y < height; y++ )
+    {
+        for( int x = 0; x < width; x++ )
+        {
+            cells[y * width + x] = closestSite<Metric>( sites, (float)x, (float)y );
+        }
+    }
+}
+
+// Scanline coherent, gives the same cells as nearestSites() (up to ties)
+//
+// Along a row the closest site rarely changes, so the winner from the previous
+// pixel is carried along and used as the starting best distance. The sites are
+// sorted by x, and the search walks outwards from the pixel's x in both
+// directions until `Metric::bound()` says nothing further away can beat the
+// current best. Inside a cell that's usually a handful of sites, it's only
+// near the cell boundaries that the search has to go wider.
+template<typename Metric>
+void nearestSitesScanline( const std::vector<Point>& sites, int width, int height, std::vector<int>& cells )
+{
+    cells.resize( width * height );
+
+    if( sites.empty() )
+    {
+        std::fill( cells.begin(), cells.end(), -1 );
+        return;
+    }
+
+    const int count = (int)sites.size();
+
+    // Sort a copy of the sites by x, remembering where each one came from
+    std::vector<int> order( count );
+    for( int i = 0; i < count; i++ ) order[i] = i;
+    std::sort( order.begin(), order.end(), [&sites]( int a, int b ) { return sites[a].x < sites[b].x; } );
+
+    std::vector<Point> sorted( count );
+    float max_weight = 0.0f;
+    for( int i = 0; i < count; i++ )
+    {
+        sorted[i] = sites[order[i]];
+        max_weight = std::max( max_weight, std::fabs( sorted[i].weight ) );
+    }
+
+    // Carried from pixel to pixel, and down to the start of the next row
+    int winner = 0;
+
+    for( int y = 0; y < height; y++ )
+    {
+        int split = 0; // First sorted site with x >= the current pixel
+
+        for( int x = 0; x < width; x++ )
+        {
+            const float fx = (float)x;
+            const float fy = (float)y;
+
+            while( split < count && sorted[split].x < fx ) split++;
+
+            float best = Metric::distance( sorted[winner], fx, fy );
+
+            for( int i = split; i < count; i++ )
+            {
+                if( Metric::bound( sorted[i].x - fx, max_weight ) >= best ) break;
+
+                float dist = Metric::distance( sorted[i], fx, fy );
+                if( dist < best )
+                {
+                    best = dist;
+                    winner = i;
+                }
+            }
+
+            for( int i = split - 1; i >= 0; i-- )
+            {
+                if( Metric::bound( fx - sorted[i].x, max_weight ) >= best ) break;
+
+                float dist = Metric::distance( sorted[i], fx, fy );
+                if( dist < best )
+                {
+                    best = dist;
+                    winner = i;
+                }
+            }
+
+            cells[y * width + x] = order[winner];
+        }
+    }
+}